@@ -0,0 +1,453 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_AC_HH
+#define TRIE_CXX_TRIE_AC_HH
+
+#include <algorithm>
+#include <istream>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "trie-pool.hh"
+#include "trie-prefilter.hh"
+
+// ac_matcher
+namespace trie {
+	/**
+	 * @brief ac_matcher is an Aho-Corasick automaton compiled from the
+	 * keys of a trie_t, to find all occurrences of all keys in a text
+	 * in one linear pass.
+	 * @details Each byte of each key is a state. A state has its goto
+	 * edges (the bytes following it in the keys), a failure link to
+	 * the state of its longest proper suffix being a prefix of some
+	 * key, and an output link to the next state on the failure chain
+	 * which ends a key.
+	 *
+	 * The shallow states, where a scan spends most of its time, are
+	 * hot: their transitions are a dense 256-entry row with the
+	 * failure links resolved already, so a byte costs one load. The
+	 * deeper states keep their edges sorted and follow the failure
+	 * links on a miss.
+	 *
+	 * While the automaton is at the root, no match is in progress, and
+	 * a literal_prefilter built from the first two bytes of the keys
+	 * skips to the next offset where a key may begin. It is enabled if
+	 * few enough byte pairs may begin a key, see prefilter().
+	 *
+	 * The matcher refers to the leaf nodes of the trie, so the trie
+	 * shall outlive it and shall not be modified while it is used.
+	 * @code{c++}
+	 * trie::trie_t<trie::value_t> tt;
+	 * tt.insert("he", 1);
+	 * tt.insert("she", 2);
+	 * tt.insert("hers", 3);
+	 * trie::ac_matcher ac(tt);
+	 * ac.scan("ushers", [](auto const &m) {
+	 *   // (1, "she"), (2, "he"), (2, "hers")
+	 *   std::cout << m.pos << ": " << m.node->path() << '\n';
+	 * });
+	 * @endcode
+	 * @tparam TrieT trie_t<...>
+	 */
+	template<typename TrieT>
+	class ac_matcher {
+	public:
+		using trie_type = TrieT;
+		using node_t = typename TrieT::node_t;
+		using state_t = std::uint32_t;
+		static constexpr state_t root_state = 0;
+
+		struct match_s {
+			std::size_t pos;    // offset of the first byte of the match in the text
+			std::size_t length; // length of the key
+			node_t const *node; // leaf node of the key, node->value() is its value
+		};
+
+		/**
+		 * @brief compile the keys of tt.
+		 * @param tt the dictionary
+		 * @param hot_depth the states up to this depth have dense
+		 * transitions, the root is always hot
+		 * @param max_hot_states at most so many dense rows (1KB each)
+		 */
+		explicit ac_matcher(TrieT const &tt, unsigned hot_depth = 1, std::size_t max_hot_states = 4096);
+
+		/**
+		 * @brief scan text, on_match(match_s const &) is called for
+		 * each occurrence of each key, ordered by their end positions,
+		 * and the longer first for the same end position.
+		 * @details on_match may return false to stop the scan.
+		 * @return false if on_match stopped the scan
+		 */
+		template<typename Fn>
+		    requires std::is_invocable_v<Fn &, match_s const &>
+		auto scan(std::string_view text, Fn &&on_match) const -> bool;
+		auto find_all(std::string_view text) const -> std::vector<match_s>;
+		/**
+		 * @brief scan an input stream in buffers of buffer_size bytes,
+		 * the matches spanning the buffers are found, and their pos
+		 * are the offsets from the beginning of the stream.
+		 */
+		template<typename Fn>
+		    requires std::is_invocable_v<Fn &, match_s const &>
+		auto scan(std::istream &is, Fn &&on_match, std::size_t buffer_size = 64 * 1024) const -> bool;
+
+		class stream;
+		/**
+		 * @brief a scanner which keeps its state across the chunks of
+		 * an input, see stream.
+		 */
+		auto make_stream() const -> stream { return stream{*this}; }
+
+		/**
+		 * @brief the same as find_all(), the chunks of text are scanned
+		 * in parallel on an executor.
+		 * @details Each chunk but the first is scanned from
+		 * max_length() - 1 bytes before its beginning, without
+		 * reporting, so that a match ending in a chunk is found by
+		 * that chunk only, even if it begins in the previous one. The
+		 * matches of the chunks are concatenated in order, so the
+		 * result equals to find_all(text).
+		 * @param text the whole text, a memory-mapped file for example
+		 * @param ex a pool::thread_pool, or any pool::executor
+		 * @param chunk_size 0 for 4 chunks per hardware thread, but no
+		 * less than 1MB each
+		 */
+		template<pool::executor Executor>
+		auto parallel_find_all(std::string_view text, Executor &ex, std::size_t chunk_size = 0) const -> std::vector<match_s>;
+		auto parallel_find_all(std::string_view text, std::size_t chunk_size = 0) const -> std::vector<match_s> {
+			auto ex = pool::default_executor();
+			return parallel_find_all(text, ex, chunk_size);
+		}
+
+		// the transition of the automaton
+		auto next(state_t s, unsigned char c) const -> state_t;
+
+		/**
+		 * @brief enable or disable the literal prefilter.
+		 * @details It is enabled by the constructor if at most 1/8 of
+		 * the byte pairs may begin a key. With more, most offsets of
+		 * a text are candidates, and skipping them costs more than it
+		 * saves.
+		 */
+		auto prefilter(bool enabled) -> void { _use_prefilter = enabled && !_prefilter.empty(); }
+		auto prefilter() const -> bool { return _use_prefilter; }
+
+		auto states() const -> std::size_t { return _states.size(); }
+		auto hot_states() const -> std::size_t { return _dense.size() / 256; }
+		auto patterns() const -> std::size_t { return _patterns; }
+		auto max_length() const -> std::size_t { return _max_length; } // length of the longest key
+
+	private:
+		struct state {
+			state_t fail{root_state};
+			state_t output{root_state}; // next state ending a key on the failure chain
+			std::uint32_t depth{};
+			std::uint32_t edge_begin{};
+			std::uint32_t edge_count{};
+			std::int32_t hot{-1};       // row in _dense, -1 if cold
+			node_t const *leaf{};       // the key ending at this state
+		};
+
+		auto go(state const &st, unsigned char c) const -> state_t {
+			auto const *first = _edge_bytes.data() + st.edge_begin;
+			auto const *last = first + st.edge_count;
+			auto const *it = std::lower_bound(first, last, c);
+			return it != last && *it == c ? _edge_targets[std::size_t(it - _edge_bytes.data())] : root_state;
+		}
+
+		template<typename Fn>
+		auto report(state_t s, std::size_t end, Fn &on_match) const -> bool;
+		// scan text from the state s, the matches are reported at
+		// base + their offsets in text. It returns the count of bytes
+		// consumed, less than text.size() if on_match stopped it.
+		template<typename Fn>
+		auto scan_internal(std::string_view text, state_t &s, std::size_t base, Fn &on_match) const -> std::size_t;
+
+	private:
+		std::vector<state> _states{};
+		std::vector<unsigned char> _edge_bytes{}; // edges of a state are sorted by their bytes
+		std::vector<state_t> _edge_targets{};
+		std::vector<state_t> _dense{};
+		std::size_t _patterns{};
+		std::size_t _max_length{};
+		literal_prefilter _prefilter{};
+		bool _use_prefilter{};
+	}; // class ac_matcher
+
+	/**
+	 * @brief stream is a streaming scanner of an ac_matcher: it keeps
+	 * the automaton state and the offset across the chunks fed to it,
+	 * so the matches spanning the chunks are found.
+	 * @code{c++}
+	 * auto st = ac.make_stream();
+	 * while (auto n = read(fd, buf, sizeof(buf)); n > 0) {
+	 *   st.feed({buf, std::size_t(n)}, [](auto const &m) {
+	 *     // m.pos is the offset from the beginning of the input
+	 *   });
+	 * }
+	 * @endcode
+	 */
+	template<typename TrieT>
+	class ac_matcher<TrieT>::stream {
+	public:
+		explicit stream(ac_matcher const &ac)
+		    : _ac(&ac) {}
+
+		/**
+		 * @brief scan the next chunk, see ac_matcher::scan().
+		 * @return false if on_match stopped the scan, the bytes after
+		 * the stopping match are not consumed then
+		 */
+		template<typename Fn>
+		    requires std::is_invocable_v<Fn &, match_s const &>
+		auto feed(std::string_view chunk, Fn &&on_match) -> bool {
+			auto const n = _ac->scan_internal(chunk, _state, _offset, on_match);
+			_offset += n;
+			return n == chunk.size();
+		}
+		// start a new input
+		auto reset() -> void {
+			_state = root_state;
+			_offset = 0;
+		}
+
+		auto offset() const -> std::size_t { return _offset; } // count of bytes consumed
+		auto state() const -> state_t { return _state; }
+
+	private:
+		ac_matcher const *_ac;
+		state_t _state{root_state};
+		std::size_t _offset{};
+	}; // class ac_matcher::stream
+} // namespace trie
+
+// ac_matcher implementations
+namespace trie {
+	template<typename TrieT>
+	inline ac_matcher<TrieT>::ac_matcher(TrieT const &tt, unsigned hot_depth, std::size_t max_hot_states) {
+		// expand the fragments of the trie into one state per byte.
+		// The children of a node are sorted by their first bytes, so
+		// the edges of each state are appended in order.
+		std::vector<std::vector<std::pair<unsigned char, state_t>>> edges(1);
+		_states.emplace_back();
+		if (auto const &root = tt.root()) {
+			struct frame {
+				node_t const *nd;
+				state_t s;
+			};
+			std::vector<frame> stack{{root.get(), root_state}};
+			while (!stack.empty()) {
+				auto const top = stack.back();
+				stack.pop_back();
+				for (auto const &ch : top.nd->children()) {
+					auto s = top.s;
+					for (auto c : ch->fragment()) {
+						auto const t = state_t(_states.size());
+						_states.emplace_back();
+						_states.back().depth = _states[s].depth + 1;
+						edges.emplace_back();
+						edges[s].emplace_back(static_cast<unsigned char>(c), t);
+						s = t;
+					}
+					if (ch->type() == node_t::NODE_LEAF) {
+						_states[s].leaf = ch.get();
+						_patterns++;
+						_max_length = std::max<std::size_t>(_max_length, _states[s].depth);
+					}
+					stack.push_back({ch.get(), s});
+				}
+			}
+		}
+
+		for (std::size_t s = 0; s < _states.size(); s++) {
+			_states[s].edge_begin = std::uint32_t(_edge_bytes.size());
+			_states[s].edge_count = std::uint32_t(edges[s].size());
+			for (auto const &[c, t] : edges[s]) {
+				_edge_bytes.push_back(c);
+				_edge_targets.push_back(t);
+			}
+		}
+		decltype(edges){}.swap(edges);
+
+		// the leading byte pairs of the keys, from the first two levels
+		auto const &root = _states[root_state];
+		for (auto e = root.edge_begin; e < root.edge_begin + root.edge_count; e++) {
+			char lead[2]{static_cast<char>(_edge_bytes[e])};
+			auto const &s1 = _states[_edge_targets[e]];
+			if (s1.leaf) _prefilter.add({lead, 1});
+			for (auto e2 = s1.edge_begin; e2 < s1.edge_begin + s1.edge_count; e2++) {
+				lead[1] = static_cast<char>(_edge_bytes[e2]);
+				_prefilter.add({lead, 2});
+			}
+		}
+		prefilter(_prefilter.density() <= 0.125);
+
+		// failure and output links in breadth-first order, the links
+		// of a state point to shallower states which are done already.
+		std::vector<state_t> order;
+		order.reserve(_states.size());
+		order.push_back(root_state);
+		for (std::size_t i = 0; i < order.size(); i++) {
+			auto const u = order[i];
+			auto const &su = _states[u];
+			for (auto e = su.edge_begin; e < su.edge_begin + su.edge_count; e++) {
+				auto const c = _edge_bytes[e];
+				auto const v = _edge_targets[e];
+				auto &sv = _states[v];
+				if (u != root_state) {
+					auto f = su.fail;
+					while (f != root_state && go(_states[f], c) == root_state) f = _states[f].fail;
+					sv.fail = go(_states[f], c);
+				}
+				auto const &sf = _states[sv.fail];
+				sv.output = sf.leaf ? sv.fail : sf.output;
+				order.push_back(v);
+			}
+		}
+
+		// dense rows of the hot states, shallower first, so that a row
+		// can copy the transitions of the failure state.
+		max_hot_states = std::max<std::size_t>(max_hot_states, 1);
+		for (auto const s : order) {
+			auto &st = _states[s];
+			if (s != root_state && (st.depth > hot_depth || hot_states() >= max_hot_states)) continue;
+			auto const row = _dense.size();
+			_dense.resize(row + 256);
+			for (unsigned c = 0; c < 256; c++) {
+				auto t = go(st, static_cast<unsigned char>(c));
+				if (t == root_state && s != root_state) t = next(st.fail, static_cast<unsigned char>(c));
+				_dense[row + c] = t;
+			}
+			st.hot = std::int32_t(row / 256);
+		}
+	}
+
+	template<typename TrieT>
+	inline auto ac_matcher<TrieT>::next(state_t s, unsigned char c) const -> state_t {
+		// the root is hot, so the loop ends there at the latest
+		for (;;) {
+			auto const &st = _states[s];
+			if (st.hot >= 0) return _dense[std::size_t(st.hot) * 256 + c];
+			if (auto const t = go(st, c); t != root_state) return t;
+			s = st.fail;
+		}
+	}
+
+	template<typename TrieT>
+	template<typename Fn>
+	inline auto ac_matcher<TrieT>::report(state_t s, std::size_t end, Fn &on_match) const -> bool {
+		auto const &st = _states[s];
+		for (auto t = st.leaf ? s : st.output; t != root_state; t = _states[t].output) {
+			auto const &out = _states[t];
+			match_s const m{end - out.depth, out.depth, out.leaf};
+			if constexpr (std::is_convertible_v<std::invoke_result_t<Fn &, match_s const &>, bool>) {
+				if (!on_match(m)) return false;
+			} else {
+				on_match(m);
+			}
+		}
+		return true;
+	}
+
+	template<typename TrieT>
+	template<typename Fn>
+	inline auto ac_matcher<TrieT>::scan_internal(std::string_view text, state_t &s, std::size_t base, Fn &on_match) const -> std::size_t {
+		for (std::size_t i = 0; i < text.size(); i++) {
+			if (s == root_state && _use_prefilter) {
+				// from the root, a byte which cannot begin a key leads
+				// back to the root without reporting.
+				i = _prefilter.find(text, i);
+				if (i == text.size()) break;
+			}
+			s = next(s, static_cast<unsigned char>(text[i]));
+			auto const &st = _states[s];
+			if (!st.leaf && st.output == root_state) continue;
+			if (!report(s, base + i + 1, on_match)) return i + 1;
+		}
+		return text.size();
+	}
+
+	template<typename TrieT>
+	template<typename Fn>
+	    requires std::is_invocable_v<Fn &, typename ac_matcher<TrieT>::match_s const &>
+	inline auto ac_matcher<TrieT>::scan(std::string_view text, Fn &&on_match) const -> bool {
+		state_t s = root_state;
+		return scan_internal(text, s, 0, on_match) == text.size();
+	}
+
+	template<typename TrieT>
+	template<typename Fn>
+	    requires std::is_invocable_v<Fn &, typename ac_matcher<TrieT>::match_s const &>
+	inline auto ac_matcher<TrieT>::scan(std::istream &is, Fn &&on_match, std::size_t buffer_size) const -> bool {
+		std::string buf(std::max<std::size_t>(buffer_size, 1), '\0');
+		auto st = make_stream();
+		while (is) {
+			is.read(buf.data(), std::streamsize(buf.size()));
+			auto const n = std::size_t(is.gcount());
+			if (n == 0) break;
+			if (!st.feed({buf.data(), n}, on_match)) return false;
+		}
+		return true;
+	}
+
+	template<typename TrieT>
+	inline auto ac_matcher<TrieT>::find_all(std::string_view text) const -> std::vector<match_s> {
+		std::vector<match_s> ret;
+		scan(text, [&ret](match_s const &m) { ret.push_back(m); });
+		return ret;
+	}
+
+	template<typename TrieT>
+	template<pool::executor Executor>
+	inline auto ac_matcher<TrieT>::parallel_find_all(std::string_view text, Executor &ex, std::size_t chunk_size) const -> std::vector<match_s> {
+		if (chunk_size == 0) {
+			auto const parts = 4 * std::size_t(std::max(1u, std::thread::hardware_concurrency()));
+			chunk_size = std::max<std::size_t>(text.size() / parts, 1 << 20);
+		}
+		auto const chunks = (text.size() + chunk_size - 1) / chunk_size;
+		if (chunks <= 1) return find_all(text);
+
+		auto const overlap = _max_length > 0 ? _max_length - 1 : 0;
+		std::vector<std::vector<match_s>> results(chunks);
+		pool::task_group tg;
+		for (std::size_t i = 0; i < chunks; i++) {
+			tg.run(ex, [this, text, chunk_size, overlap, i, &res = results[i]] {
+				auto const begin = i * chunk_size;
+				auto const warm = std::min(begin, overlap);
+				state_t s = root_state;
+				for (auto c : text.substr(begin - warm, warm)) s = next(s, static_cast<unsigned char>(c));
+				auto collect = [&res](match_s const &m) { res.push_back(m); };
+				scan_internal(text.substr(begin, chunk_size), s, begin, collect);
+			});
+		}
+		tg.wait(ex);
+
+		std::size_t total{};
+		for (auto const &r : results) total += r.size();
+		std::vector<match_s> ret;
+		ret.reserve(total);
+		for (auto &r : results) ret.insert(ret.end(), r.begin(), r.end());
+		return ret;
+	}
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_AC_HH
@@ -24,8 +24,18 @@
  * @brief trie-tree, radix-tree, and store
  */
 
+#include "trie-ac.hh"
 #include "trie-base.hh"
 #include "trie-chrono.hh"
 #include "trie-core.hh"
+#include "trie-frontcode.hh"
+#include "trie-generator.hh"
+#include "trie-intern.hh"
+#include "trie-keygen.hh"
+#include "trie-olc.hh"
+#include "trie-pool.hh"
+#include "trie-prefilter.hh"
+#include "trie-query.hh"
+#include "trie-segment.hh"
 
 #endif // TRIE_CXX_TRIE_HH
@@ -20,6 +20,7 @@
 #include <any>
 #include <optional>
 #include <tuple>
+#include <type_traits>
 #include <valarray>
 #include <variant>
 
@@ -28,9 +29,11 @@
 #include <deque>
 #include <iterator>
 #include <list>
+#include <queue>
 #include <stack>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <cerrno>
@@ -43,11 +46,16 @@
 #include <iostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 
 #include "trie-base.hh"
 #include "trie-chrono.hh"
+#include "trie-frontcode.hh"
+#include "trie-generator.hh"
 #include "trie-node.hh"
+#include "trie-pool.hh"
+#include "trie-query.hh"
 
 // node
 namespace trie {
@@ -70,6 +78,13 @@ namespace trie {
 			NODE_BRANCH,
 		};
 
+		// what a visitor of the template walk() asks for next
+		enum WalkAction {
+			WALK_CONTINUE, // visit the children of this node, then go on
+			WALK_PRUNE,    // skip the subtree below this node, then go on
+			WALK_STOP,     // stop the walk
+		};
+
 		using ext_pkg_t = ExtPkgT;
 
 		using node_t = node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>;
@@ -78,6 +93,7 @@ namespace trie {
 		using comment_t = typename CommentT::comment_t;
 		using tag_t = typename TagT::tag_t;
 		using node_type = NodeType;
+		using walk_action = WalkAction;
 		using node_ptr = std::shared_ptr<node_t>;
 		using const_node_ptr = std::shared_ptr<node_t const>;
 		using weak_node_ptr = std::weak_ptr<node_t>;
@@ -99,15 +115,29 @@ namespace trie {
 			value_t old{};
 		};
 
+		/**
+		 * @brief the result of try_emplace(), insert_or_assign() and
+		 * emplace(): the value stored for the key.
+		 * @details The pointer is valid until the trie is modified, a
+		 * later insert may split the node and move the value.
+		 */
+		struct emplace_return_s {
+			value_t *ptr{};  // the stored value, nullptr if !ok
+			bool ok{};       // false for an empty path, with EINVAL
+			bool inserted{}; // false if path was a key already
+			errno_t en{};
+			auto value() const -> value_t & { return *ptr; }
+		};
+
 		struct const_find_return_s {
 			std::size_t partial_matched_size{};
 			const_weak_node_ptr ptr{};
 			errno_t en{};
 			bool matched{};
 			const_find_return_s() = default;
-			const_find_return_s(std::size_t pms, weak_node_ptr &ptr_, errno_t en_, bool m)
+			const_find_return_s(std::size_t pms, const_weak_node_ptr ptr_, errno_t en_, bool m)
 			    : partial_matched_size(pms)
-			    , ptr(ptr_)
+			    , ptr(std::move(ptr_))
 			    , en(en_)
 			    , matched(m) {
 			}
@@ -144,11 +174,17 @@ namespace trie {
 		struct const_locate_return_s final : public const_find_return_s {
 			std::vector<const_weak_node_ptr> *parents{};
 			const_locate_return_s() = default;
-			const_locate_return_s(std::size_t pms, weak_node_ptr &ptr_, errno_t en_, bool m,
+			const_locate_return_s(std::size_t pms, const_weak_node_ptr ptr_, errno_t en_, bool m,
 			                      std::vector<const_weak_node_ptr> *pv)
-			    : find_return_s(pms, ptr_, en_, m)
+			    : const_find_return_s(pms, std::move(ptr_), en_, m)
 			    , parents(pv) {
 			}
+			const_locate_return_s(const_locate_return_s &&o) noexcept
+			    : const_find_return_s(o) {
+				parents = o.parents;
+				o.parents = nullptr;
+			}
+			const_locate_return_s(const_locate_return_s const &) = delete;
 			~const_locate_return_s() override {
 				if (parents) delete parents;
 			}
@@ -178,10 +214,10 @@ namespace trie {
 				ret.en = this->en;
 				ret.matched = this->matched;
 				if (this->parents) {
-					std::vector<const_weak_node_ptr> *p = new std::vector<const_weak_node_ptr>();
-					p->reserve(this->parents->size());
+					ret.parents = new std::vector<const_weak_node_ptr>();
+					ret.parents->reserve(this->parents->size());
 					for (auto &el : *parents) {
-						p->push_back(el);
+						ret.parents->push_back(el);
 					}
 				}
 				return ret;
@@ -200,22 +236,34 @@ namespace trie {
 		    , _fragment(std::move(o._fragment))
 		    , _fragment_length(o._fragment_length)
 		    , _value(std::move(o._value))
-		    , _children(std::move(o._children)) {
+		    , _children(std::move(o._children))
+		    , _leaves(o._leaves)
+		    , _scores(std::move(o._scores)) {
+			for (auto &ch : _children) ch->_parent = this;
+			if (_scores) {
+				for (auto &c : _scores->best) {
+					if (c.ptr == &o) c.ptr = this;
+				}
+			}
 		}
-		explicit node(const node_type type, std::string const &full, std::string const &frag, value_t &&val)
+		// the strings are taken by value and moved in, the value is
+		// constructed in place from args
+		explicit node(const node_type type, std::string full, std::string frag, value_t &&val)
 		    : _type(type)
-		    , _path(full)
-		    , _fragment(frag)
-		    , _fragment_length(frag.length())
-		    , _value(std::move(val)) {
+		    , _path(std::move(full))
+		    , _fragment(std::move(frag))
+		    , _fragment_length(_fragment.length())
+		    , _value(std::move(val))
+		    , _leaves(type == NODE_LEAF ? 1 : 0) {
 		}
 		template<typename... Args>
-		explicit node(node_type type, std::string const &full, std::string const &frag, Args &&...args)
+		explicit node(node_type type, std::string full, std::string frag, Args &&...args)
 		    : _type(type)
-		    , _path(full)
-		    , _fragment(frag)
-		    , _fragment_length(frag.length())
-		    , _value(std::forward<Args>(args)...) {
+		    , _path(std::move(full))
+		    , _fragment(std::move(frag))
+		    , _fragment_length(_fragment.length())
+		    , _value(std::forward<Args>(args)...)
+		    , _leaves(type == NODE_LEAF ? 1 : 0) {
 		}
 
 	public:
@@ -233,7 +281,12 @@ namespace trie {
 		value_t const &value() const { return _value; }
 		void value(value_t &&val) { std::swap(_value, val); }
 		node_type type() const { return _type; } // node type: branch, leaf or none.
-		void type(node_type t) { _type = t; }
+		void type(node_type t) {
+			if ((t == NODE_LEAF) != (_type == NODE_LEAF))
+				add_leaves(t == NODE_LEAF ? 1 : -1);
+			_type = t;
+			if (t != NODE_LEAF && weighted()) clear_weight(); // a branch holds no key
+		}
 		desc_t const &desc() const { return _pkg.desc(); } // leaf node's description
 		node_t &desc(desc_t const &s) {
 			_pkg.desc(s);
@@ -250,6 +303,43 @@ namespace trie {
 			return (*this);
 		}
 
+		// scored completions
+
+	public:
+		using weight_t = double;
+		struct completion_s {
+			node_t const *ptr{}; // the leaf node of the key
+			weight_t weight{};
+			auto operator==(completion_s const &) const -> bool = default;
+		};
+		// the count of the best completions cached in each node
+		static constexpr std::size_t completion_cache_size = 10;
+
+		auto weighted() const -> bool { return _scores && _scores->weighted; } // whether this key has a weight
+		auto weight() const -> weight_t { return _scores ? _scores->weight : weight_t{}; }
+		/**
+		 * @brief set the weight of this key, which makes it a completion
+		 * of its prefixes.
+		 * @details The cached best completions of this node and of its
+		 * ancestors are updated, up to the first one left unchanged.
+		 * @return false if this node is not a leaf
+		 */
+		auto weight(weight_t w) -> bool;
+		auto clear_weight() -> void;
+		/**
+		 * @brief the best weighted keys of this subtree, at most
+		 * completion_cache_size, by weight descending then by key.
+		 */
+		auto best_completions() const -> std::vector<completion_s> const & {
+			static std::vector<completion_s> const none{};
+			return _scores ? _scores->best : none;
+		}
+		// whether a ranks before b in the completions
+		static auto better(completion_s const &a, completion_s const &b) -> bool {
+			if (a.weight != b.weight) return a.weight > b.weight;
+			return a.ptr->_path < b.ptr->_path;
+		}
+
 		// pure trie-tree interfaces
 
 	public:
@@ -260,118 +350,51 @@ namespace trie {
 		auto insert(char const *path, char const *value) -> return_s;
 		template<typename... Args, std::enable_if_t<std::is_constructible_v<value_t, Args...>, bool> = true>
 		auto insert(char const *path, Args &&...args) -> return_s {
-			return_s ret{};
-			if (!path) return ret;
-
-			find_return_s fr{};
-			if (auto path_len = std::strlen(path); fast_find_internal(fr, path, path_len)) {
-				// matched
-				if (fr.partial_matched_size == 0) {
-					// matched a node completely, replace it with new value
-					if (node_ptr sp = fr.ptr.lock()) {
-						sp->_value.swap(ret.old);
-						sp->_value.template emplace<Args...>(args...);
-						ret.ok = true;
-					}
-					return ret; // return {{}, false};
-				}
-
-				// split the node:
-				//
-				// `herz -> hers` to:
-				//   `her->s`
-				//      `->z`
-				if (node_ptr sp = fr.ptr.lock()) {
-					auto const frag = sp->fragment();
-					auto const minus = sp->fragment_length() - fr.partial_matched_size;
-					if (minus == 0) {
-						// insert as child simply
-						std::string new_path{path};
-						auto const title = new_path.substr(sp->path().length());
-						node_ptr new_leaf = std::make_shared<node_t>(
-						        NODE_LEAF, new_path,
-						        title, args...);
-						sp->add(new_leaf);
-						ret.ok = true;
-						return ret;
-					}
-
-					auto const full_path = sp->path();
-					ret.old = sp->set_value(std::move(ret.old));
-					sp->path(full_path.substr(0, full_path.length() - minus));
-					sp->fragment(frag.substr(0, fr.partial_matched_size));
-					sp->type(NODE_BRANCH);
-
-					node_ptr child = std::make_shared<node_t>(
-					        NODE_LEAF, full_path.substr(full_path.length() - minus - 1),
-					        frag.substr(fr.partial_matched_size), std::move(ret.old));
-					sp->add(child);
-
-					std::string new_path{path};
-					auto const title = new_path.substr(new_path.length() - minus - 1);
-					node_ptr new_leaf = std::make_shared<node_t>(
-					        NODE_LEAF, new_path,
-					        title, args...);
-					sp->add(new_leaf);
-
-					ret.ok = true;
-					return ret;
-				}
-			} else {
-				if (fr.partial_matched_size > 0) {
-					if (node_ptr sp = fr.ptr.lock()) {
-						auto const frag = sp->fragment();
-						auto const minus = sp->fragment_length() - fr.partial_matched_size;
-
-						if (minus == 0) {
-							// add child directly
-							auto rest_title = path + sp->path().length();
-							node_ptr new_leaf = std::make_shared<node_t>(
-							        NODE_LEAF, path, rest_title, args...);
-							sp->add(new_leaf);
-							ret.ok = true;
-							return ret;
-						}
-
-						// split the node pointed by sp
-						auto const dad_title = frag.substr(0, fr.partial_matched_size);
-						auto const full_path = sp->path();
-						ret.old = sp->set_value(std::move(ret.old));
-						sp->path(full_path.substr(0, full_path.length() - minus));
-						sp->fragment(dad_title);
-						sp->type(NODE_BRANCH);
-
-						auto const child_title = frag.substr(fr.partial_matched_size);
-						node_ptr child = std::make_shared<node_t>(
-						        NODE_LEAF, full_path,
-						        child_title, std::move(ret.old));
-						sp->add(child);
-
-						// auto rest = path + partial_matched_size;
-						// ret = sp->insert(rest, std::move(value));
-
-						auto const rest_title = path + sp->path().length();
-						node_ptr new_leaf = std::make_shared<node_t>(
-						        NODE_LEAF, path, rest_title, args...);
-						sp->add(new_leaf);
-
-						ret.ok = true;
-					}
-					return ret;
-				}
+			return emplace_internal(path, std::forward<Args>(args)...);
+		}
 
-				// insert full
-				auto sp = this->shared_from_this();
-				ret.old = sp->set_value(std::move(ret.old));
-				std::string new_path{path};
-				node_ptr new_leaf = std::make_shared<node_t>(NODE_LEAF, new_path, new_path, args...);
-				sp->add(new_leaf);
-				sp->type(NODE_BRANCH);
-				ret.ok = true;
-			}
+		/**
+		 * @brief construct the value of path from args in place if path
+		 * is not a key yet, otherwise leave the key and args untouched.
+		 * @details Like std::map::try_emplace, no value is made, copied
+		 * or moved when the key exists. A new leaf constructs its value
+		 * directly inside the node.
+		 * @code
+		 * auto r = nd.try_emplace("app.server.hosts", std::vector<std::string>{"a", "b"});
+		 * if (!r.inserted) std::get<std::vector<std::string>>(r.value()).push_back("c");
+		 * @endcode
+		 */
+		template<typename... Args>
+		auto try_emplace(char const *path, Args &&...args) -> emplace_return_s {
+			return try_emplace_internal(path, std::forward<Args>(args)...);
+		}
+		// assign v to the value of path if it is a key, or construct it from v.
+		template<typename V>
+		auto insert_or_assign(char const *path, V &&v) -> emplace_return_s {
+			auto ret = try_emplace_internal(path, std::forward<V>(v));
+			if (ret.ok && !ret.inserted) *ret.ptr = std::forward<V>(v); // v was not used
+			return ret;
+		}
+		// construct the value of path from args, replacing the old one if any.
+		template<typename... Args>
+		auto emplace(char const *path, Args &&...args) -> emplace_return_s {
+			auto ret = try_emplace_internal(path, std::forward<Args>(args)...);
+			if (ret.ok && !ret.inserted) *ret.ptr = value_t(std::forward<Args>(args)...); // args were not used
 			return ret;
 		}
 
+		/**
+		 * @brief insert a key greater than every key in this subtree, by
+		 * the rightmost path of it instead of a lookup from the top.
+		 * @details spine is the rightmost path from this node down to
+		 * its greatest key, it is filled when empty and kept up to date
+		 * by each call. A key not greater than the greatest one is
+		 * inserted as usual and spine is rebuilt. This node is meant to
+		 * be the root.
+		 */
+		template<typename... Args>
+		auto emplace_sorted(std::vector<node_t *> &spine, std::string const &path, Args &&...args) -> return_s;
+
 		auto remove(std::string const &path, bool include_children = true) -> return_s; // remove if exists
 		auto remove(char const *path, bool include_children = true) -> return_s;
 
@@ -384,12 +407,34 @@ namespace trie {
 		auto fast_find(char const *path) const -> const_find_return_s;
 
 	private:
-		auto locate_internal(char const *path, weak_node_ptr parent) -> locate_return_s;
-		auto find_internal(char const *path) -> find_return_s;
-		auto fast_find_internal(find_return_s &ctx, char const *path, std::size_t path_len) -> bool;
+		template<typename Self>
+		using weak_ptr_of = std::conditional_t<std::is_const_v<Self>, const_weak_node_ptr, weak_node_ptr>;
+		template<typename Self>
+		using locate_return_of = std::conditional_t<std::is_const_v<Self>, const_locate_return_s, locate_return_s>;
+
+		// The lookup cores are shared by the const and non-const apis.
+		// Self is node_t or node_t const, so that a const lookup reaches
+		// the nodes through const pointers only and never writes to
+		// any shared state: concurrent const lookups on a tree which
+		// is not being modified are data-race-free.
+		template<typename Self>
+		static auto locate_internal(Self *self, char const *path, weak_ptr_of<Self> parent) -> locate_return_of<Self>;
+		template<typename Self, typename Ctx>
+		static auto fast_find_internal(Self *self, Ctx &ctx, char const *path, std::size_t path_len) -> bool;
+		template<typename Self>
+		static auto child_of(Self *self, char first_byte) -> Self *;
 
 	public:
 		auto children_count() const -> std::size_t { return _children.size(); }
+		auto leaves() const -> std::size_t { return _leaves; } // count of leaves in this subtree, O(1)
+		auto parent() const -> node_t const * { return _parent; }
+		auto children() const -> children_t const & { return _children; } // sorted by their first bytes
+		struct first_byte_less {
+			auto operator()(node_ptr const &a, char b) const -> bool {
+				return static_cast<unsigned char>(a->_fragment.front()) < static_cast<unsigned char>(b);
+			}
+		};
+		auto child(char first_byte) const -> node_t const * { return child_of(this, first_byte); } // O(log fanout)
 
 		// auto root() const -> weak_node_ptr;
 
@@ -444,13 +489,88 @@ namespace trie {
 		using walk_cb = std::function<void(node_type type, const_node_ptr,
 		                                   int index, int level)>;
 		auto walk(walk_cb cb) const -> void;
+		/**
+		 * @brief walk this subtree in pre-order with a visitor inlined
+		 * into the loop.
+		 * @details visitor(node_t const &nd, int index, int level) is
+		 * called for the same nodes as walk(walk_cb), but with a plain
+		 * reference instead of a shared_ptr copy per node, and without
+		 * recursion. It may return a walk_action to prune the subtree
+		 * below nd or to stop the walk; returning void means
+		 * WALK_CONTINUE.
+		 * @code{c++}
+		 * nd->walk([](node_t const &nd, int, int level) {
+		 *   if (level > 2) return node_t::WALK_PRUNE;
+		 *   std::cout << nd.path() << '\n';
+		 *   return node_t::WALK_CONTINUE;
+		 * });
+		 * @endcode
+		 * @return false if the visitor stopped the walk
+		 */
+		template<typename Visitor>
+		    requires std::is_invocable_v<Visitor &, node_t const &, int, int>
+		auto walk(Visitor &&visitor) const -> bool;
+
+		// parallel interfaces
+
+	public:
+		/**
+		 * @brief walk all nodes, the subtrees in parallel on an executor.
+		 * @details The tree is split into about `parts` subtrees (4 per
+		 * hardware thread if 0) which are walked concurrently by the
+		 * executor, so cb must be thread-safe, and it cannot rely on the
+		 * visiting order across subtrees. The few nodes above the split
+		 * are visited on the calling thread.
+		 * @param cb the same callback as walk()
+		 * @param ex a pool::thread_pool, or any pool::executor
+		 * @param parts the expected count of subtrees
+		 */
+		template<pool::executor Executor>
+		auto parallel_walk(walk_cb const &cb, Executor &ex, std::size_t parts = 0) const -> void;
+		/**
+		 * @brief fold the leaves with map/reduce, the subtrees in parallel.
+		 * @details map(node_t const &leaf) -> R is called for each leaf,
+		 * reduce(R, R) -> R combines the results. The partial results of
+		 * the subtrees are reduced in tree order, so reduce needs not be
+		 * commutative.
+		 */
+		template<typename R, typename Map, typename Reduce, pool::executor Executor>
+		auto parallel_reduce(R init, Map &&map, Reduce &&reduce, Executor &ex, std::size_t parts = 0) const -> R;
+		/**
+		 * @brief render the same text as dump() with the subtrees
+		 * rendered into their own buffers in parallel.
+		 */
+		template<pool::executor Executor>
+		auto parallel_dump(std::ostream &os, Executor &ex, std::size_t parts = 0) const -> std::ostream &;
+
+	protected:
+		struct walk_part {
+			node_t const *nd;
+			int index;
+			int level;
+			bool whole; // the whole subtree, or this node alone
+		};
+		// split this subtree, in pre-order, into about `want` whole
+		// subtrees and the nodes above them.
+		auto split_parts(std::size_t want) const -> std::vector<walk_part>;
 
 	protected:
+		template<typename... Args>
+		auto emplace_internal(char const *path, Args &&...args) -> return_s;
+		template<typename... Args>
+		auto try_emplace_internal(char const *path, Args &&...args) -> emplace_return_s;
+		auto split_at(std::size_t pos) -> void;
+		auto compact() -> void;
+		auto add_leaves(std::ptrdiff_t delta) -> void;
+		auto update_best() -> void;
+		auto promote_best(completion_s const &c) -> void;
+
 		auto set_value(value_t &&val) -> value_t;
 		auto add(node_ptr child) -> void;
 		auto del(node_ptr child) -> void;
 		auto dump_r(std::ostream &os, std::stringstream &ss, int level) const -> std::ostream &;
-		auto walk_internal(walk_cb cb, int index, int level) const -> void;
+		auto dump_line(std::stringstream &ss, int level) const -> void;
+		auto walk_internal(walk_cb const &cb, int index, int level) const -> void;
 		auto removed_fully(return_s &ret,
 		                   char const *path,
 		                   bool include_children,
@@ -466,6 +586,15 @@ namespace trie {
 		value_t _value{};       // the payload
 		children_t _children{}; // children nodes
 		ext_pkg_t _pkg{};
+		node_t *_parent{};       // the owner of this node, nullptr for root
+		std::size_t _leaves{0}; // count of leaves in this subtree, including this node
+
+		struct scores_s {
+			weight_t weight{};
+			bool weighted{};
+			std::vector<completion_s> best{};
+		};
+		std::unique_ptr<scores_s> _scores{}; // nullptr if no weighted key in this subtree
 
 		static int _dump_left_width;
 	};
@@ -533,6 +662,7 @@ namespace trie {
 		using const_locate_return_t = typename node_t::const_locate_return_t;
 
 		using return_s = typename node_t::return_s;
+		using emplace_return_s = typename node_t::emplace_return_s;
 		using find_return_s = typename node_t::find_return_s;
 		using const_find_return_s = typename node_t::const_find_return_s;
 		using locate_return_s = typename node_t::locate_return_s;
@@ -547,6 +677,32 @@ namespace trie {
 			return _root->insert(path, std::forward<Args>(args)...);
 		}
 		auto insert(char const *path, char const *value) -> return_s { return _root->insert(path, value); }
+
+		/**
+		 * @brief construct the value of path in place from args, unless
+		 * path is a key already.
+		 * @details These follow std::map: try_emplace() neither makes
+		 * nor moves a value for an existing key, insert_or_assign()
+		 * assigns to it, and emplace() replaces it. Each returns the
+		 * stored value, valid until the trie is modified.
+		 * @code
+		 * auto r = tt.try_emplace("app.server.port", 8080);
+		 * std::get<int>(r.value()) += 1;
+		 * @endcode
+		 */
+		template<typename... Args>
+		auto try_emplace(char const *path, Args &&...args) -> emplace_return_s {
+			return _root->try_emplace(path, std::forward<Args>(args)...);
+		}
+		template<typename V>
+		auto insert_or_assign(char const *path, V &&v) -> emplace_return_s {
+			return _root->insert_or_assign(path, std::forward<V>(v));
+		}
+		template<typename... Args>
+		auto emplace(char const *path, Args &&...args) -> emplace_return_s {
+			return _root->emplace(path, std::forward<Args>(args)...);
+		}
+
 		auto remove(std::string const &path, bool include_children = true) -> return_s; // remove if exists
 		auto remove(char const *path, bool include_children = true) -> return_s;
 
@@ -554,7 +710,7 @@ namespace trie {
 		auto find(char const *path) const -> const_find_return_s;
 		auto locate(char const *path) -> locate_return_s;
 
-		auto fast_find(char const *path) const -> const_find_return_s { return _root->fast_find(path).to_const(); }
+		auto fast_find(char const *path) const -> const_find_return_s { return std::as_const(*_root).fast_find(path); }
 		auto fast_find(char const *path) -> find_return_s { return _root->fast_find(path); }
 
 		// store apis
@@ -588,12 +744,12 @@ namespace trie {
 		 */
 		template<class T, class... Types>
 		auto get(char const *path) const -> T const & {
-			auto &var = const_cast<node_t *>(_root.get())->get(path);
+			auto &var = std::as_const(*_root).get(path);
 			return std::get<T, Types...>(var);
 		}
 		template<class T, class... Types>
 		auto get(char const *path, value_t const &default_val) const -> T const & {
-			auto &var = const_cast<node_t *>(_root.get())->get(path, default_val);
+			auto &var = std::as_const(*_root).get(path, default_val);
 			return std::get<T, Types...>(var);
 		}
 
@@ -651,9 +807,294 @@ namespace trie {
 		 * @param cb
 		 */
 		auto walk(walk_cb cb) const -> void { _root->walk(cb); }
+		/**
+		 * @brief store api: walk all keys with a visitor inlined into the
+		 * loop, no shared_ptr is copied per node.
+		 * @details The visitor may return node_t::WALK_PRUNE to skip the
+		 * subtree below a node, or node_t::WALK_STOP to end the walk.
+		 * @code
+		 * std::size_t leaves{};
+		 * tt.walk([&leaves](trie_t::node_t const &nd, int, int) {
+		 *   if (nd.type() == trie_t::node_t::NODE_LEAF) leaves++;
+		 * });
+		 * @endcode
+		 * @return false if the visitor stopped the walk
+		 */
+		template<typename Visitor>
+		    requires std::is_invocable_v<Visitor &, node_t const &, int, int>
+		auto walk(Visitor &&visitor) const -> bool { return _root->walk(std::forward<Visitor>(visitor)); }
 
 		auto dump(std::ostream &os) const -> std::ostream &;
 
+		/**
+		 * @brief get the topmost node whose subtree holds all keys
+		 * beginning with prefix.
+		 * @details The prefix is matched byte by byte, it needs not end
+		 * at a delimiter. The returned node may have a longer path than
+		 * prefix, for example "app.lo" returns the node "app.logging.".
+		 * @return nullptr if no key begins with prefix
+		 */
+		auto prefix_node(char const *prefix) const -> const_node_ptr;
+
+		// scored autocomplete
+
+	public:
+		using weight_t = typename node_t::weight_t;
+		using completion_s = typename node_t::completion_s;
+		/**
+		 * @brief set the weight of a key, for complete().
+		 * @details Each node caches the best node_t::completion_cache_size
+		 * weighted keys of its subtree, so setting a weight updates the
+		 * caches along the path of the key, and inserting or removing
+		 * keys keeps them up to date. Keys without a weight are not
+		 * completions.
+		 * @return false if path is not a key
+		 */
+		auto set_weight(char const *path, weight_t weight) -> bool;
+		auto clear_weight(char const *path) -> bool;
+		/**
+		 * @brief the k weighted keys beginning with prefix with the
+		 * highest weights, by weight descending then by key.
+		 * @details Up to node_t::completion_cache_size, the result is
+		 * the cache of the node at prefix, found in O(|prefix|). A
+		 * larger k runs a best-first search over the subtree guided
+		 * by the caches, which visits the nodes on the way to the k
+		 * results only.
+		 * @code
+		 * tt.insert("hello", 1);
+		 * tt.set_weight("hello", 120.0);
+		 * for (auto const &c : tt.complete("he", 5))
+		 *   std::cout << c.ptr->path() << ' ' << c.weight << '\n';
+		 * @endcode
+		 */
+		auto complete(char const *prefix, std::size_t k) const -> std::vector<completion_s>;
+
+		// routing-style lookups
+
+	public:
+		/**
+		 * @brief the result of longest_prefix_match(): the deepest key
+		 * being a prefix of the query, and its length.
+		 */
+		template<typename Node>
+		struct basic_prefix_match_s {
+			Node *ptr{};                  // the leaf node of the matched key, nullptr if no key matched
+			std::size_t matched_length{}; // the length of the matched key
+			bool matched{};
+		};
+		using prefix_match_s = basic_prefix_match_s<node_t>;
+		using const_prefix_match_s = basic_prefix_match_s<node_t const>;
+
+		/**
+		 * @brief find the longest key which is a prefix of query, in one
+		 * descent and without allocation.
+		 * @details The key is matched byte by byte, so "app.log"
+		 * matches the query "app.logging". See longest_path_match() for
+		 * the delimiter-aligned matching.
+		 * @code
+		 * tt.insert("app.logging", "log-handler");
+		 * auto ret = tt.longest_prefix_match("app.logging.file");
+		 * // ret.matched == true, ret.matched_length == 11,
+		 * // ret.ptr->value() is "log-handler".
+		 * @endcode
+		 */
+		auto longest_prefix_match(std::string_view query) const -> const_prefix_match_s { return longest_match_internal(query, false); }
+		auto longest_prefix_match(std::string_view query) -> prefix_match_s { return mutable_match(longest_match_internal(query, false)); }
+		/**
+		 * @brief find the longest key which is a prefix of query and
+		 * ends at a delimiter of query.
+		 * @details A key matches if it is the whole query, or if the
+		 * query continues with a delimiter after it, or if the key
+		 * ends with a delimiter itself. So "app.log" does not match
+		 * "app.logging.file", but "app.logging" and "app.logging." do.
+		 * This is the lookup of a routing table mapping the config
+		 * sections to their handlers.
+		 */
+		auto longest_path_match(std::string_view query) const -> const_prefix_match_s { return longest_match_internal(query, true); }
+		auto longest_path_match(std::string_view query) -> prefix_match_s { return mutable_match(longest_match_internal(query, true)); }
+
+		// approximate lookups
+
+	public:
+		struct fuzzy_match_s {
+			node_t const *ptr{};    // the leaf node of the key
+			std::size_t distance{}; // the edit distance from the query
+		};
+		/**
+		 * @brief find the keys within max_edits edits (insertions,
+		 * deletions, substitutions of a byte) from query.
+		 * @details The trie is walked with one row of the Levenshtein
+		 * table per byte of the path, so the rows of a common prefix
+		 * are computed once. A subtree is pruned as soon as every
+		 * cell of the row exceeds max_edits, since the distance never
+		 * decreases along a path.
+		 * @code
+		 * for (auto const &m : tt.fuzzy_find("app.loging.file", 2))
+		 *   std::cout << m.ptr->path() << ": " << m.distance << '\n';
+		 * @endcode
+		 * @return the matches ordered by distance, then by key
+		 */
+		auto fuzzy_find(std::string_view query, std::size_t max_edits) const -> std::vector<fuzzy_match_s>;
+
+		// pattern queries
+
+	public:
+		/**
+		 * @brief call fn(node_t const &leaf) for each key matching a
+		 * delimiter-aware glob pattern, in the order of the keys.
+		 * @details See query::compile_glob() for the syntax: `*` is
+		 * one segment, `**` any number of segments, `?` and `[a-z]`
+		 * one byte. The pattern runs as an automaton along the trie,
+		 * a subtree is pruned as soon as no key below can match, and
+		 * where the pattern allows a few bytes only (the literal
+		 * parts) the children are looked up instead of visited.
+		 * @code
+		 * tt.glob("app.server.**.timeout", [](auto const &nd) {
+		 *   std::cout << nd.path() << '\n';
+		 * });
+		 * @endcode
+		 */
+		template<typename Fn>
+		    requires std::is_invocable_v<Fn &, node_t const &>
+		auto glob(std::string_view pattern, Fn &&fn) const -> void {
+			auto a = query::compile_glob(pattern, delimiter);
+			match_internal(a, fn);
+		}
+		auto glob(std::string_view pattern) const -> std::vector<node_t const *> {
+			std::vector<node_t const *> ret;
+			glob(pattern, [&ret](node_t const &nd) { ret.push_back(&nd); });
+			return ret;
+		}
+
+		struct regex_return_s {
+			bool ok{};
+			errno_t en{};            // EINVAL if the pattern is invalid
+			std::size_t error_pos{}; // where the pattern is invalid
+			std::vector<node_t const *> matches{};
+		};
+		/**
+		 * @brief call fn(node_t const &leaf) for each key matching a
+		 * regular expression as a whole, like std::regex_match, in the
+		 * order of the keys.
+		 * @details See query::compile_regex() for the syntax, a subset
+		 * without backtracking. The pattern is compiled to a DFA which
+		 * advances along the fragments of the trie, so a common prefix
+		 * is matched once and a subtree is pruned at the first byte no
+		 * key below can continue with. Use `.*` at the ends to search
+		 * for a part of the keys.
+		 * @code
+		 * tt.regex_find(R"(app\.server\.(port|timeout)\d*)", [](auto const &nd) {
+		 *   std::cout << nd.path() << '\n';
+		 * });
+		 * @endcode
+		 * @return false if the pattern is invalid
+		 */
+		template<typename Fn>
+		    requires std::is_invocable_v<Fn &, node_t const &>
+		auto regex_find(std::string_view pattern, Fn &&fn) const -> bool {
+			auto a = query::compile_regex(pattern);
+			if (!a) return false;
+			match_internal(*a, fn);
+			return true;
+		}
+		auto regex_find(std::string_view pattern) const -> regex_return_s {
+			regex_return_s ret;
+			auto a = query::compile_regex(pattern, &ret.error_pos);
+			if (!a) {
+				ret.en = EINVAL;
+				return ret;
+			}
+			auto collect = [&ret](node_t const &nd) { ret.matches.push_back(&nd); };
+			match_internal(*a, collect);
+			ret.ok = true;
+			return ret;
+		}
+
+	private:
+		auto longest_match_internal(std::string_view query, bool aligned) const -> const_prefix_match_s;
+		template<typename Fn>
+		auto match_internal(query::automaton &a, Fn &fn) const -> void;
+		static auto mutable_match(const_prefix_match_s const &r) -> prefix_match_s {
+			return {const_cast<node_t *>(r.ptr), r.matched_length, r.matched};
+		}
+
+		// parallel apis. Without an explicit executor, they run on
+		// pool::default_executor(): the shared pool::default_pool(), or
+		// an external executor plugged in by pool::use_executor().
+
+	public:
+		/**
+		 * @brief store api: walk all keys, the subtrees in parallel on
+		 * an executor. cb must be thread-safe.
+		 * @code
+		 * trie::pool::thread_pool pool;
+		 * std::atomic<int> leaves{};
+		 * tt.parallel_walk([&leaves](auto type, auto, int, int) {
+		 *   if (type == trie_t::node_t::NODE_LEAF) leaves++;
+		 * }, pool);
+		 * @endcode
+		 */
+		template<pool::executor Executor>
+		auto parallel_walk(walk_cb const &cb, Executor &ex) const -> void { _root->parallel_walk(cb, ex); }
+		auto parallel_walk(walk_cb const &cb) const -> void {
+			auto ex = pool::default_executor();
+			parallel_walk(cb, ex);
+		}
+
+		/**
+		 * @brief the same as size(), the subtrees are counted in parallel.
+		 */
+		template<pool::executor Executor>
+		auto parallel_size(Executor &ex) const -> std::size_t {
+			return _root->parallel_reduce(
+			        std::size_t{0}, [](node_t const &) { return std::size_t{1}; },
+			        [](std::size_t a, std::size_t b) { return a + b; }, ex);
+		}
+		auto parallel_size() const -> std::size_t {
+			auto ex = pool::default_executor();
+			return parallel_size(ex);
+		}
+
+		/**
+		 * @brief the same as dump(), the subtrees are rendered in parallel.
+		 */
+		template<pool::executor Executor>
+		auto parallel_dump(std::ostream &os, Executor &ex) const -> std::ostream & { return _root->parallel_dump(os, ex); }
+		template<pool::executor Executor>
+		auto parallel_dump(Executor &ex) const -> std::string {
+			std::stringstream ss;
+			_root->parallel_dump(ss, ex);
+			return ss.str();
+		}
+		auto parallel_dump() const -> std::string {
+			auto ex = pool::default_executor();
+			return parallel_dump(ex);
+		}
+
+		/**
+		 * @brief aggregate the leaves under a key prefix, the subtrees
+		 * in parallel.
+		 * @details map(node_t const &leaf) -> R, reduce(R, R) -> R.
+		 * @code
+		 * // sum of all int values under "app.logging."
+		 * auto sum = tt.parallel_reduce("app.logging.", 0,
+		 *     [](auto const &nd) { return std::get<int>(nd.value()); },
+		 *     std::plus<int>{}, pool);
+		 * @endcode
+		 * @return init if no key begins with prefix
+		 */
+		template<typename R, typename Map, typename Reduce, pool::executor Executor>
+		auto parallel_reduce(char const *prefix, R init, Map &&map, Reduce &&reduce, Executor &ex) const -> R {
+			if (auto nd = prefix_node(prefix))
+				return nd->parallel_reduce(std::move(init), std::forward<Map>(map), std::forward<Reduce>(reduce), ex);
+			return init;
+		}
+		template<typename R, typename Map, typename Reduce>
+		auto parallel_reduce(char const *prefix, R init, Map &&map, Reduce &&reduce) const -> R {
+			auto ex = pool::default_executor();
+			return parallel_reduce(prefix, std::move(init), std::forward<Map>(map), std::forward<Reduce>(reduce), ex);
+		}
+
 	public:
 		node_ptr root(node_ptr new_root) {
 			node_ptr old;
@@ -665,61 +1106,336 @@ namespace trie {
 		node_ptr const &root() const { return _root; }
 
 		/**
-		 * @brief calculating the count of leaves keys recursively.
+		 * @brief the count of leaves keys, O(1).
 		 * @return the total amount
 		 */
 		auto size() const -> std::size_t;
+		/**
+		 * @brief the count of leaves keys beginning with prefix, O(depth).
+		 * @code
+		 * auto n = tt.count_prefix("app.logging.");
+		 * @endcode
+		 */
+		auto count_prefix(char const *prefix) const -> std::size_t;
 
-	private:
-		auto ensure_root() -> node_ptr &;
+		// order statistics, keys are ordered by bytes, like std::string
 
-	private:
-		node_ptr _root{};
-		node_ptr _empty{};
-	}; // class trie_t<...>
-} // namespace trie
+	public:
+		/**
+		 * @brief a range of keys, see split_ranges().
+		 * @details [first, last] are inclusive, they are the keys at
+		 * offset and offset + count - 1 in the key order.
+		 */
+		struct key_range {
+			std::size_t offset{};
+			std::size_t count{};
+			std::string first{};
+			std::string last{};
+		};
 
+		/**
+		 * @brief the count of keys less than key, O(depth * fanout).
+		 * @details key needs not exist. If it exists,
+		 * select(rank(key)) returns its node.
+		 */
+		auto rank(char const *key) const -> std::size_t;
+		/**
+		 * @brief the leaf node of the i-th key (0-based) in key order,
+		 * O(depth * fanout).
+		 * @return nullptr if i >= size()
+		 * @code
+		 * // a page of 50 keys from offset 1000
+		 * for (auto i = 1000; i < 1050; i++)
+		 *   if (auto nd = tt.select(i)) std::cout << nd->path() << '\n';
+		 * @endcode
+		 */
+		auto select(std::size_t i) const -> const_node_ptr;
+		/**
+		 * @brief the i-th key (0-based) in key order.
+		 * @return std::nullopt if i >= size()
+		 */
+		auto nth_key(std::size_t i) const -> std::optional<std::string> {
+			if (auto nd = select(i)) return nd->path();
+			return std::nullopt;
+		}
+		/**
+		 * @brief split the keys into k consecutive ranges with the leaf
+		 * counts differing by one at most, to partition the keyspace
+		 * between workers.
+		 * @return at most k ranges, no empty range
+		 */
+		auto split_ranges(std::size_t k) const -> std::vector<key_range>;
 
-// node<ValueT, TagT, char delimiter>
-namespace trie {
-	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
-	int node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::_dump_left_width{32};
+		// ordered iterators
 
+	public:
+		/**
+		 * @brief a bidirectional iterator over the leaves in key order.
+		 * @details It keeps the path from root to the current leaf in an
+		 * explicit stack of (node, index in parent) frames, so stepping
+		 * is amortized O(1) and calls no std::function. Inserting or
+		 * removing keys invalidates all iterators.
+		 * @code
+		 * // all keys in ["app.a", "app.m")
+		 * for (auto it = tt.lower_bound("app.a"), e = tt.lower_bound("app.m"); it != e; ++it)
+		 *   std::cout << it.key() << " = " << it->value() << '\n';
+		 * @endcode
+		 */
+		class const_iterator {
+		public:
+			using iterator_category = std::bidirectional_iterator_tag;
+			using value_type = node_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = node_t const *;
+			using reference = node_t const &;
+
+			const_iterator() = default;
+
+			auto operator*() const -> reference { return *_stack.back().nd; }
+			auto operator->() const -> pointer { return _stack.back().nd; }
+			auto key() const -> std::string const & { return _stack.back().nd->path(); }
+
+			auto operator++() -> const_iterator & {
+				do advance(); while (!_stack.empty() && !at_leaf());
+				return *this;
+			}
+			auto operator++(int) -> const_iterator {
+				auto tmp = *this;
+				++*this;
+				return tmp;
+			}
+			auto operator--() -> const_iterator & {
+				do retreat(); while (!_stack.empty() && !at_leaf());
+				return *this;
+			}
+			auto operator--(int) -> const_iterator {
+				auto tmp = *this;
+				--*this;
+				return tmp;
+			}
 
-	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
-	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        set(char const *path, value_t &&value) -> return_s {
-		return insert(path, std::move(value));
-	}
+			friend auto operator==(const_iterator const &a, const_iterator const &b) -> bool {
+				if (a._stack.empty() || b._stack.empty()) return a._stack.empty() == b._stack.empty();
+				return a._stack.back().nd == b._stack.back().nd;
+			}
+			friend auto operator!=(const_iterator const &a, const_iterator const &b) -> bool { return !(a == b); }
 
-	/**
-	 * @brief get_node_with_info find a full node like
-	 * 'app.debug' or a partial node (branch or leaf)
-	 * like 'app.logging.'.
-	 * @details get_node_with_info checks tail delimiter
-	 * (typically '.'), if so, it treats the case as fully
-	 * matched, rather than partial matched (returned by
-	 * find(path)). This behavior is to help inspecting
-	 * store path (a dotted path) separated by delimiter
-	 * char.
-	 * A store, Store, which has path separated by delimiter
-	 * like dot char ('.'), is an advance trie-tree for
-	 * providing in-memory key-value paire with hierarchical
-	 * data (tree data). A yaml config file is store's
-	 * prefer persistent form.
-	 * @tparam ValueT
-	 * @tparam TagT
-	 * @tparam delimiter
-	 * @param path a key path
-	 * @return a tuple with [pms, node_ptr, errno, matched].
-	 */
-	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
-	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        get_node_with_info(char const *path) const -> find_return_s {
-		auto ret = fast_find(path);
-		if (ret.matched) return ret;
-		if (ret.partial_matched_size > 0) {
-			if (auto sp = ret.ptr.lock()) {
+		private:
+			friend class trie_t;
+			struct frame {
+				node_t const *nd;
+				std::size_t index; // index of nd in the children of its parent
+			};
+
+			explicit const_iterator(node_t const *root)
+			    : _root(root) {}
+
+			auto at_leaf() const -> bool { return _stack.back().nd->type() == node_t::NODE_LEAF; }
+			auto push(std::size_t index) -> void {
+				_stack.push_back({_stack.back().nd->children()[index].get(), index});
+			}
+			// go to the next node in pre-order, after the subtree of the top
+			auto skip_subtree() -> void {
+				while (_stack.size() > 1) {
+					auto const index = _stack.back().index;
+					_stack.pop_back();
+					if (index + 1 < _stack.back().nd->children().size()) {
+						push(index + 1);
+						return;
+					}
+				}
+				_stack.clear(); // end()
+			}
+			// go to the next node in pre-order
+			auto advance() -> void {
+				if (!_stack.back().nd->children().empty()) {
+					push(0);
+					return;
+				}
+				skip_subtree();
+			}
+			// go to the previous node in pre-order, end() moves to the last node
+			auto retreat() -> void {
+				if (_stack.empty()) {
+					_stack.push_back({_root, 0});
+				} else {
+					if (_stack.size() == 1) {
+						_stack.clear(); // before begin()
+						return;
+					}
+					auto const index = _stack.back().index;
+					_stack.pop_back();
+					if (index == 0) return; // the parent
+					push(index - 1);
+				}
+				while (!_stack.back().nd->children().empty())
+					push(_stack.back().nd->children().size() - 1);
+			}
+			// stop at the first leaf at or after the top
+			auto settle() -> const_iterator & {
+				if (!_stack.empty() && !at_leaf()) ++*this;
+				return *this;
+			}
+
+		private:
+			node_t const *_root{};
+			std::vector<frame> _stack{}; // empty for end()
+		};
+		using iterator = const_iterator;
+
+		auto begin() const -> const_iterator;
+		auto end() const -> const_iterator { return const_iterator{_root.get()}; }
+		auto cbegin() const -> const_iterator { return begin(); }
+		auto cend() const -> const_iterator { return end(); }
+		/**
+		 * @brief the first key not less than key, O(depth * log fanout).
+		 */
+		auto lower_bound(char const *key) const -> const_iterator;
+		/**
+		 * @brief the first key greater than key, O(depth * log fanout).
+		 */
+		auto upper_bound(char const *key) const -> const_iterator;
+		auto equal_range(char const *key) const -> std::pair<const_iterator, const_iterator> {
+			return {lower_bound(key), upper_bound(key)};
+		}
+
+		// lazy enumeration
+
+	public:
+		template<typename V>
+		using scan_result = std::pair<std::string_view, V &>;
+
+		/**
+		 * @brief store api: enumerate the leaves beginning with prefix
+		 * in key order, lazily.
+		 * @details The returned coroutine generator descends the tree
+		 * only as far as the consumer iterates, so breaking out of the
+		 * loop early costs nothing for the rest of the subtree. Each key
+		 * is rebuilt from the fragments in one reusable buffer, the
+		 * key_view is valid until the next iteration only.
+		 * The trie must outlive the generator and must not be modified
+		 * while it is in use.
+		 * @code
+		 * int n{0};
+		 * for (auto [key, value] : tt.scan_prefix("app.logging.")) {
+		 *   std::cout << key << " = " << value << '\n';
+		 *   if (++n == 50) break;
+		 * }
+		 * @endcode
+		 */
+		auto scan_prefix(std::string prefix) -> generator<scan_result<value_t>> {
+			return scan_prefix_internal<node_t>(_root.get(), std::move(prefix));
+		}
+		auto scan_prefix(std::string prefix) const -> generator<scan_result<value_t const>> {
+			return scan_prefix_internal<node_t const>(_root.get(), std::move(prefix));
+		}
+
+		// sorted bulk loading and front-coded key sets
+
+	public:
+		/**
+		 * @brief bulk_builder inserts keys given in increasing order
+		 * along the rightmost path of the trie, without a lookup from
+		 * the root for each of them.
+		 * @details A key out of order is inserted as usual, only more
+		 * slowly. The trie must not be modified by anything else while
+		 * a builder is in use.
+		 * @code
+		 * auto b = tt.bulk();
+		 * for (auto const &[k, v] : sorted_pairs) b.add(k, v);
+		 * @endcode
+		 */
+		class bulk_builder {
+		public:
+			explicit bulk_builder(trie_t &tt)
+			    : _root(tt.ensure_root().get()) {}
+			template<typename... Args>
+			auto add(std::string const &path, Args &&...args) -> return_s {
+				if (path.empty()) return return_s{};
+				return _root->emplace_sorted(_spine, path, std::forward<Args>(args)...);
+			}
+
+		private:
+			node_t *_root;
+			std::vector<node_t *> _spine{};
+		};
+		auto bulk() -> bulk_builder { return bulk_builder{*this}; }
+
+		/**
+		 * @brief append all keys to out in the front-coded format of
+		 * trie-frontcode.hh, in one ordered walk.
+		 * @details Each key is stored as the length it shares with the
+		 * previous one and the rest of it, and every restart_interval
+		 * keys one is stored whole for frontcode::reader to seek by.
+		 * @return the count of keys
+		 */
+		auto export_keys(std::string &out, std::size_t restart_interval = 16) const -> std::size_t;
+		/**
+		 * @brief insert the keys of a front-coded buffer through a
+		 * bulk_builder, with the values value_of(std::string_view key)
+		 * returns, or value_t{}.
+		 * @return false if data is corrupt, the keys before the
+		 * corruption are inserted already
+		 */
+		auto import_keys(std::string_view data) -> bool {
+			return import_keys(data, [](std::string_view) { return value_t{}; });
+		}
+		template<typename Fn>
+		auto import_keys(std::string_view data, Fn &&value_of) -> bool;
+
+	private:
+		auto ensure_root() -> node_ptr &;
+		template<typename Node>
+		static auto scan_prefix_internal(Node *root, std::string prefix)
+		        -> generator<scan_result<std::conditional_t<std::is_const_v<Node>, value_t const, value_t>>>;
+
+	private:
+		node_ptr _root{};
+		node_ptr _empty{};
+	}; // class trie_t<...>
+} // namespace trie
+
+
+// node<ValueT, TagT, char delimiter>
+namespace trie {
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	int node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::_dump_left_width{32};
+
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        set(char const *path, value_t &&value) -> return_s {
+		return insert(path, std::move(value));
+	}
+
+	/**
+	 * @brief get_node_with_info find a full node like
+	 * 'app.debug' or a partial node (branch or leaf)
+	 * like 'app.logging.'.
+	 * @details get_node_with_info checks tail delimiter
+	 * (typically '.'), if so, it treats the case as fully
+	 * matched, rather than partial matched (returned by
+	 * find(path)). This behavior is to help inspecting
+	 * store path (a dotted path) separated by delimiter
+	 * char.
+	 * A store, Store, which has path separated by delimiter
+	 * like dot char ('.'), is an advance trie-tree for
+	 * providing in-memory key-value paire with hierarchical
+	 * data (tree data). A yaml config file is store's
+	 * prefer persistent form.
+	 * @tparam ValueT
+	 * @tparam TagT
+	 * @tparam delimiter
+	 * @param path a key path
+	 * @return a tuple with [pms, node_ptr, errno, matched].
+	 */
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        get_node_with_info(char const *path) const -> find_return_s {
+		auto ret = fast_find(path);
+		if (ret.matched) return ret;
+		if (ret.partial_matched_size > 0) {
+			if (auto sp = ret.ptr.lock()) {
 				auto const &frag = sp->fragment();
 				auto const size = sp->fragment_length();
 				if (size == ret.partial_matched_size + 1 && frag[size - 1] == delimiter) {
@@ -812,7 +1528,7 @@ namespace trie {
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        walk_internal(walk_cb cb, int index, int level) const -> void {
+	        walk_internal(walk_cb const &cb, int index, int level) const -> void {
 		if (_type != NODE_NONE) {
 			auto ptr = this->shared_from_this();
 			cb(_type, ptr, index, level);
@@ -823,6 +1539,155 @@ namespace trie {
 			ch->walk_internal(cb, idx++, level + 1);
 		}
 	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Visitor>
+	    requires std::is_invocable_v<Visitor &, node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT> const &, int, int>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        walk(Visitor &&visitor) const -> bool {
+		auto visit = [&visitor](node_t const &nd, int index, int level) -> walk_action {
+			if (nd._type == NODE_NONE) return WALK_CONTINUE;
+			if constexpr (std::is_void_v<std::invoke_result_t<Visitor &, node_t const &, int, int>>) {
+				visitor(nd, index, level);
+				return WALK_CONTINUE;
+			} else {
+				return walk_action(visitor(nd, index, level));
+			}
+		};
+
+		if (auto const act = visit(*this, 0, 0); act != WALK_CONTINUE)
+			return act != WALK_STOP;
+
+		// the frames are the nodes whose children are being visited,
+		// the level of a child is the depth of the stack.
+		struct frame {
+			node_t const *nd;
+			std::size_t next;
+		};
+		std::vector<frame> stack;
+		stack.reserve(32);
+		stack.push_back({this, 0});
+		while (!stack.empty()) {
+			auto &top = stack.back();
+			if (top.next == top.nd->_children.size()) {
+				stack.pop_back();
+				continue;
+			}
+			auto const idx = top.next++;
+			node_t const *ch = top.nd->_children[idx].get();
+			auto const act = visit(*ch, int(idx), int(stack.size()));
+			if (act == WALK_STOP) return false;
+			if (act == WALK_CONTINUE && !ch->_children.empty())
+				stack.push_back({ch, 0}); // top is invalidated from here
+		}
+		return true;
+	}
+} // namespace trie
+
+// parallel_walk, parallel_reduce, parallel_dump
+namespace trie {
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        split_parts(std::size_t want) const -> std::vector<walk_part> {
+		if (want == 0)
+			want = 4 * std::max(1u, std::thread::hardware_concurrency());
+
+		// expand the whole subtrees level by level, so that the parts
+		// are still in pre-order after each round.
+		std::vector<walk_part> parts{{this, 0, 0, true}};
+		for (std::size_t wholes = 1; wholes < want;) {
+			std::vector<walk_part> next;
+			next.reserve(parts.size() * 2);
+			wholes = 0;
+			bool grown{};
+			for (auto const &p : parts) {
+				if (!p.whole || p.nd->_children.empty()) {
+					next.push_back(p);
+					wholes += p.whole;
+					continue;
+				}
+				next.push_back({p.nd, p.index, p.level, false});
+				auto idx{0};
+				for (auto const &ch : p.nd->_children) {
+					next.push_back({ch.get(), idx++, p.level + 1, true});
+					wholes++;
+				}
+				grown = true;
+			}
+			parts.swap(next);
+			if (!grown) break;
+		}
+		return parts;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<pool::executor Executor>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        parallel_walk(walk_cb const &cb, Executor &ex, std::size_t parts) const -> void {
+		pool::task_group tg;
+		for (auto const &p : split_parts(parts)) {
+			if (p.whole && !p.nd->_children.empty()) {
+				tg.run(ex, [&cb, p] { p.nd->walk_internal(cb, p.index, p.level); });
+			} else if (p.nd->_type != NODE_NONE) {
+				cb(p.nd->_type, p.nd->shared_from_this(), p.index, p.level);
+			}
+		}
+		tg.wait(ex);
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename R, typename Map, typename Reduce, pool::executor Executor>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        parallel_reduce(R init, Map &&map, Reduce &&reduce, Executor &ex, std::size_t parts) const -> R {
+		auto const split = split_parts(parts);
+		std::vector<std::optional<R>> results(split.size());
+		pool::task_group tg;
+		for (std::size_t i = 0; i < split.size(); i++) {
+			auto const &p = split[i];
+			if (p.nd->_type != NODE_LEAF && (!p.whole || p.nd->_children.empty()))
+				continue;
+			tg.run(ex, [&map, &reduce, &res = results[i], p] {
+				auto fold = [&map, &reduce, &res](node_t const &nd, int, int) {
+					if (nd._type != NODE_LEAF) return;
+					res = res ? reduce(std::move(*res), map(nd)) : map(nd);
+				};
+				if (p.whole)
+					p.nd->walk(fold);
+				else
+					fold(*p.nd, p.index, p.level);
+			});
+		}
+		tg.wait(ex);
+
+		for (auto &r : results) {
+			if (r) init = reduce(std::move(init), std::move(*r));
+		}
+		return init;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<pool::executor Executor>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        parallel_dump(std::ostream &os, Executor &ex, std::size_t parts) const -> std::ostream & {
+		auto const split = split_parts(parts);
+		std::vector<std::string> buffers(split.size());
+		pool::task_group tg;
+		for (std::size_t i = 0; i < split.size(); i++) {
+			tg.run(ex, [&buf = buffers[i], p = split[i]] {
+				std::stringstream ss;
+				if (p.whole)
+					p.nd->dump_r(ss, ss, p.level);
+				else
+					p.nd->dump_line(ss, p.level);
+				buf = ss.str();
+			});
+		}
+		tg.wait(ex);
+
+		os << "<root>\n";
+		for (auto const &buf : buffers) os << buf;
+		return os << '\n';
+	}
 } // namespace trie
 
 // insert, remove, find, locate, dump, to_string, root
@@ -836,124 +1701,271 @@ namespace trie {
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        insert(char const *path, char const *value) -> return_s {
-		value_t v{value};
-		return insert(path, std::move(v));
+		return emplace_internal(path, value);
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        insert(char const *path, value_t &&value) -> return_s {
+		return emplace_internal(path, std::move(value));
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename... Args>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        emplace_internal(char const *path, Args &&...args) -> return_s {
 		return_s ret{};
-		if (!path) return ret;
+		auto r = try_emplace_internal(path, std::forward<Args>(args)...);
+		if (!r.ok) return ret;
+		if (!r.inserted) {
+			// args were left untouched, replace the value by them
+			ret.old = std::exchange(*r.ptr, value_t(std::forward<Args>(args)...));
+		}
+		ret.ok = true;
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename... Args>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        try_emplace_internal(char const *path, Args &&...args) -> emplace_return_s {
+		emplace_return_s ret{};
+		if (!path || !*path) {
+			ret.en = EINVAL;
+			return ret;
+		}
+		ret.ok = ret.inserted = true;
 
 		find_return_s fr{};
-		if (auto path_len = std::strlen(path); fast_find_internal(fr, path, path_len)) {
-			// matched
-			if (fr.partial_matched_size == 0) {
-				// matched a node completely, replace it with new value
-				if (node_ptr sp = fr.ptr.lock()) {
-					ret.old = sp->set_value(std::move(value));
-					ret.ok = true;
-				}
-				return ret; // return {{}, false};
-			}
-
-			// split the node:
-			//
-			// `herz -> hers` to:
-			//   `her->s`
-			//      `->z`
-			if (node_ptr sp = fr.ptr.lock()) {
-				auto const frag = sp->fragment();
-				auto const minus = sp->fragment_length() - fr.partial_matched_size;
-				if (minus == 0) {
-					// insert as child simply
-					std::string new_path{path};
-					std::string title = new_path.substr(sp->path().length());
-					node_ptr new_leaf = std::make_shared<node_t>(
-					        NODE_LEAF, new_path,
-					        title, std::move(value));
-					sp->add(new_leaf);
-					ret.ok = true;
-					return ret;
-				}
+		auto const path_len = std::strlen(path);
+		auto const matched = fast_find_internal(this, fr, path, path_len);
+		node_ptr sp = fr.ptr.lock();
+		if (!sp) {
+			// insert full, no common prefix with any child
+			auto child = std::make_shared<node_t>(NODE_LEAF, std::string{path, path_len}, std::string{path, path_len}, std::forward<Args>(args)...);
+			ret.ptr = &child->_value;
+			add(std::move(child));
+			type(NODE_BRANCH);
+			return ret;
+		}
 
-				auto full_path = sp->path();
-				ret.old = sp->set_value(std::move(ret.old));
-				sp->path(full_path.substr(0, full_path.length() - minus));
-				sp->fragment(frag.substr(0, fr.partial_matched_size));
-				sp->type(NODE_BRANCH);
-
-				node_ptr child = std::make_shared<node_t>(
-				        NODE_LEAF, full_path.substr(full_path.length() - minus - 1),
-				        frag.substr(fr.partial_matched_size), std::move(ret.old));
-				sp->add(child);
-
-				std::string new_path{path};
-				std::string title = new_path.substr(new_path.length() - minus - 1);
-				node_ptr new_leaf = std::make_shared<node_t>(
-				        NODE_LEAF, new_path,
-				        title, std::move(value));
-				sp->add(new_leaf);
-
-				ret.ok = true;
+		ret.ptr = &sp->_value;
+		if (matched) {
+			if (sp->_type == NODE_LEAF) {
+				// a key already, args are not used
+				ret.inserted = false;
 				return ret;
 			}
+			// a branch becoming a key
+			sp->_value = value_t(std::forward<Args>(args)...);
+			sp->_type = NODE_LEAF;
+			sp->add_leaves(1);
+			return ret;
+		}
+
+		// split the node if the path diverges inside its fragment:
+		//
+		// `herz -> hers` to:
+		//   `her->s`
+		//      `->z`
+		if (fr.partial_matched_size < sp->_fragment_length)
+			sp->split_at(fr.partial_matched_size);
+
+		if (path_len == sp->_path.length()) {
+			// the path ends at the split point: `her` into `hers`
+			sp->_value = value_t(std::forward<Args>(args)...);
+			sp->_type = NODE_LEAF;
+			sp->add_leaves(1);
 		} else {
-			if (fr.partial_matched_size > 0) {
-				if (node_ptr sp = fr.ptr.lock()) {
-					auto const frag = sp->fragment();
-					auto const minus = sp->fragment_length() - fr.partial_matched_size;
-
-					if (minus == 0) {
-						// add child directly
-						auto rest_title = path + sp->path().length();
-						node_ptr new_leaf = std::make_shared<node_t>(
-						        NODE_LEAF, path, rest_title, std::move(value));
-						sp->add(new_leaf);
-						ret.ok = true;
-						return ret;
-					}
+			auto const *rest_title = path + sp->_path.length();
+			auto child = std::make_shared<node_t>(NODE_LEAF, std::string{path, path_len}, std::string{rest_title, std::size_t(path + path_len - rest_title)}, std::forward<Args>(args)...);
+			ret.ptr = &child->_value;
+			sp->add(std::move(child));
+		}
+		return ret;
+	}
 
-					// split the node pointed by sp
-					auto dad_title = frag.substr(0, fr.partial_matched_size);
-					auto full_path = sp->path();
-					ret.old = sp->set_value(std::move(ret.old));
-					sp->path(full_path.substr(0, full_path.length() - minus));
-					sp->fragment(dad_title);
-					sp->type(NODE_BRANCH);
-
-					auto child_title = frag.substr(fr.partial_matched_size);
-					node_ptr child = std::make_shared<node_t>(
-					        NODE_LEAF, full_path,
-					        child_title, std::move(ret.old));
-					sp->add(child);
-
-					// auto rest = path + partial_matched_size;
-					// ret = sp->insert(rest, std::move(value));
-
-					auto rest_title = path + sp->path().length();
-					node_ptr new_leaf = std::make_shared<node_t>(
-					        NODE_LEAF, path, rest_title, std::move(value));
-					sp->add(new_leaf);
-
-					ret.ok = true;
-				}
-				return ret;
-			}
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename... Args>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        emplace_sorted(std::vector<node_t *> &spine, std::string const &path, Args &&...args) -> return_s {
+		auto rebuild = [this, &spine] {
+			spine.assign(1, this);
+			while (!spine.back()->_children.empty()) spine.push_back(spine.back()->_children.back().get());
+		};
+		if (spine.empty() || spine.front() != this) rebuild();
 
-			// insert full
-			auto sp = this->shared_from_this();
-			ret.old = sp->set_value(std::move(ret.old));
-			std::string new_path{path};
-			node_ptr new_leaf = std::make_shared<node_t>(NODE_LEAF, new_path, new_path, std::move(value));
-			sp->add(new_leaf);
-			sp->type(NODE_BRANCH);
-			ret.ok = true;
+		auto const &last = spine.back()->_path;
+		if (spine.size() == 1 || !(last < path)) {
+			// not after the greatest key
+			auto ret = emplace_internal(path.c_str(), std::forward<Args>(args)...);
+			rebuild();
+			return ret;
+		}
+
+		// the key leaves the rightmost path at shared, below the deepest
+		// node whose path is not longer than that:
+		//
+		// `hers` then `hiss`:
+		//   `h->ers`  into  `h->ers`
+		//                      `->iss`
+		std::size_t shared{};
+		for (auto const n = std::min(last.size(), path.size()); shared < n && last[shared] == path[shared];) shared++;
+		auto i = spine.size() - 1;
+		while (spine[i]->_path.size() > shared) i--;
+		auto *dad = spine[i];
+		if (dad->_path.size() < shared) {
+			dad = spine[++i];
+			dad->split_at(dad->_fragment_length - (dad->_path.size() - shared));
 		}
+		spine.resize(i + 1);
+
+		auto child = std::make_shared<node_t>(NODE_LEAF, path, path.substr(shared), std::forward<Args>(args)...);
+		spine.push_back(child.get());
+		dad->add(std::move(child)); // the greatest first byte, appended
+		if (dad == this) type(NODE_BRANCH);
+		return_s ret{};
+		ret.ok = true;
 		return ret;
 	}
 
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        split_at(std::size_t pos) -> void {
+		// a branch holds no value to move
+		auto child = _type == NODE_LEAF ? std::make_shared<node_t>(_type, _path, _fragment.substr(pos), std::move(_value))
+		                                : std::make_shared<node_t>(_type, _path, _fragment.substr(pos));
+		child->_pkg = std::move(_pkg);
+		child->_children.swap(_children);
+		for (auto &ch : child->_children) ch->_parent = child.get();
+		child->_leaves = _leaves;
+		child->_parent = this;
+
+		_path.resize(_path.length() - (_fragment_length - pos));
+		_fragment.resize(pos); // in place, without a new string
+		_fragment_length = pos;
+		if (_type == NODE_LEAF) _value = value_t{};
+		_type = NODE_BRANCH;
+		_pkg = ext_pkg_t{};
+		child->_scores = std::move(_scores);
+		if (child->_scores) {
+			// the same subtree, until the child is recomputed
+			_scores = std::make_unique<scores_s>();
+			_scores->best = child->_scores->best;
+		}
+		auto *moved = child.get();
+		_children.push_back(std::move(child)); // the subtree leaves are unchanged
+		if (moved->_scores) moved->update_best(); // the key of this node moved into the child
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        compact() -> void {
+		if (!_parent || _type == NODE_LEAF) return; // root, or holding a value
+
+		if (_children.empty()) {
+			// drop a branch left without children
+			auto *dad = _parent;
+			dad->del(this->shared_from_this());
+			dad->compact();
+			return;
+		}
+
+		if (_children.size() == 1) {
+			// merge a branch left with one child into it
+			auto ch = std::move(_children.front());
+			_children = std::move(ch->_children);
+			for (auto &c : _children) c->_parent = this;
+			_type = ch->_type;
+			_value = std::move(ch->_value);
+			_pkg = std::move(ch->_pkg);
+			_path = std::move(ch->_path);
+			_fragment += ch->_fragment;
+			_fragment_length = _fragment.length();
+			ch->_parent = nullptr; // the subtree leaves are unchanged
+			_scores = std::move(ch->_scores);
+			if (_scores) update_best(); // the key of the child moved into this node
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        add_leaves(std::ptrdiff_t delta) -> void {
+		for (auto *p = this; p; p = p->_parent)
+			p->_leaves = std::size_t(std::ptrdiff_t(p->_leaves) + delta);
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        update_best() -> void {
+		// the best of a subtree are among its own key and the best of
+		// its children, so a node is recomputed from them; once a node
+		// is left unchanged, so are its ancestors.
+		std::vector<completion_s> best;
+		for (auto *p = this; p; p = p->_parent) {
+			best.clear();
+			if (p->_type == NODE_LEAF && p->weighted()) best.push_back({p, p->_scores->weight});
+			for (auto const &ch : p->_children) {
+				if (ch->_scores) best.insert(best.end(), ch->_scores->best.begin(), ch->_scores->best.end());
+			}
+			auto const n = std::min(best.size(), completion_cache_size);
+			std::partial_sort(best.begin(), best.begin() + std::ptrdiff_t(n), best.end(), better);
+			best.resize(n);
+			if (best == p->best_completions()) return;
+
+			if (best.empty() && !p->weighted()) {
+				p->_scores.reset();
+				continue;
+			}
+			if (!p->_scores) p->_scores = std::make_unique<scores_s>();
+			p->_scores->best = best;
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        promote_best(completion_s const &c) -> void {
+		// a new key, or a key ranking higher than before, only moves up
+		// in the caches: it is merged into each of them until one does
+		// not hold it.
+		for (auto *p = this; p; p = p->_parent) {
+			if (!p->_scores) p->_scores = std::make_unique<scores_s>();
+			auto &best = p->_scores->best;
+			auto it = std::find_if(best.begin(), best.end(), [&c](auto const &x) { return x.ptr == c.ptr; });
+			if (it != best.end()) {
+				best.erase(it);
+			} else if (best.size() == completion_cache_size) {
+				if (!better(c, best.back())) return;
+				best.pop_back();
+			}
+			best.insert(std::upper_bound(best.begin(), best.end(), c, better), c);
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        weight(weight_t w) -> bool {
+		if (_type != NODE_LEAF) return false;
+		if (!_scores) _scores = std::make_unique<scores_s>();
+		bool const raised = !_scores->weighted || w >= _scores->weight;
+		_scores->weight = w;
+		_scores->weighted = true;
+		if (raised)
+			promote_best({this, w});
+		else
+			update_best();
+		return true;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        clear_weight() -> void {
+		if (!weighted()) return;
+		_scores->weighted = false;
+		_scores->weight = weight_t{};
+		update_best();
+	}
+
 	// template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	// template<typename... Args, std::enable_if_t<std::is_constructible_v<value_t, Args...>, bool>>
 	// inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
@@ -964,16 +1976,21 @@ namespace trie {
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        set_value(value_t &&val) -> ValueT {
-		auto ret = std::move(this->_value);
-		std::swap(this->_value, val);
-		return ret;
+		return std::exchange(_value, std::move(val));
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        add(node_ptr it) -> void {
-		// weak_node_ptr ptr = node;
-		_children.push_back(std::move(it));
+		it->_parent = this;
+		add_leaves(std::ptrdiff_t(it->_leaves));
+		// keep children in the order of their first bytes, which are
+		// unique among siblings, so that walking the tree in pre-order
+		// visits the keys in byte order.
+		auto pos = std::lower_bound(_children.begin(), _children.end(), it->_fragment.front(), first_byte_less{});
+		bool const scored = it->_scores != nullptr;
+		_children.insert(pos, std::move(it));
+		if (scored) update_best();
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
@@ -984,8 +2001,12 @@ namespace trie {
 		        [it](auto const &ptr) -> bool {
 			        return it.get() == ptr.get();
 		        });
-		if (position != _children.end()) // == myVector.end() means the element was not found
+		if (position != _children.end()) { // == myVector.end() means the element was not found
+			add_leaves(-std::ptrdiff_t(it->_leaves));
+			it->_parent = nullptr;
 			_children.erase(position);
+			if (it->_scores) update_best();
+		}
 	}
 
 	inline std::size_t common_prefix(const char *s1, std::size_t const s1_len, const char *s2, std::size_t const s2_len) {
@@ -1019,218 +2040,151 @@ namespace trie {
 		find_return_s ret;
 		if (!path) return ret;
 		auto const path_len = std::strlen(path);
-		fast_find_internal(ret, path, path_len);
+		fast_find_internal(this, ret, path, path_len);
 		return ret;
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        fast_find(const char *path) const -> const_find_return_s {
-		find_return_s ret;
-		if (!path) return ret.to_const();
+		const_find_return_s ret;
+		if (!path) return ret;
 		auto const path_len = std::strlen(path);
-		const_cast<node_t *>(this)->fast_find_internal(ret, path, path_len);
-		return ret.to_const();
+		fast_find_internal(this, ret, path, path_len);
+		return ret;
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        locate(const char *path) const -> const_locate_return_s {
-		locate_return_s ret = const_cast<node_t *>(this)->locate_internal(path, weak_node_ptr{});
-		return ret.to_const_obj();
-		//
-		// std::vector<const_weak_node_ptr> *v2 = new std::vector<const_weak_node_ptr>();
-		// std::for_each(vec->begin(), vec->end(), [v2](auto it) { v2->push_back(it); });
-		//
-		// return {pms, v2, ptr, en, matched};
+		return locate_internal(this, path, const_weak_node_ptr{});
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        locate(const char *path) -> locate_return_s {
-		static weak_node_ptr tmp_ptr{};
-		locate_return_s ret = this->locate_internal(path, tmp_ptr);
-		return ret;
+		return locate_internal(this, path, weak_node_ptr{});
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Self, typename Ctx>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        find_internal(const char *path) -> find_return_s {
-		auto ret = locate_internal(path, weak_node_ptr{});
-		return ret;
-	}
-
-	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
-	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        fast_find_internal(find_return_s &ctx, const char *path, std::size_t path_len) -> bool {
-		if (_fragment_length == 0) {
-			if (_children.size() > 0) {
-				// for root node only
-				// auto wp_this = this->weak_from_this();
-				for (auto const &ch : _children) {
-					auto ret1 = ch->fast_find_internal(ctx, path, path_len);
-					if (ret1 || ctx.partial_matched_size > 0) {
-						return ret1;
-					}
-				}
+	        fast_find_internal(Self *self, Ctx &ctx, const char *path, std::size_t path_len) -> bool {
+		if (self->_fragment_length == 0) {
+			// for root node only
+			if (auto *ch = child_of(self, *path)) {
+				return fast_find_internal(ch, ctx, path, path_len);
 			}
 			return ctx.matched;
 		}
 
-		auto cp = common_prefix(_fragment.c_str(), _fragment_length, path, path_len);
+		auto cp = common_prefix(self->_fragment.c_str(), self->_fragment_length, path, path_len);
 		if (cp == 0) {
 			return ctx.matched;
 		}
 
 		// auto const path_len = std::strlen(path);
-		if (_fragment_length == cp) {
-			if (_fragment_length == path_len) {
-				ctx.ptr = this->weak_from_this();
+		if (self->_fragment_length == cp) {
+			if (self->_fragment_length == path_len) {
+				ctx.ptr = self->weak_from_this();
 				ctx.matched = true;
 				return true;
 			}
 
-			if (_fragment_length < path_len) {
-				auto const *rest = path + _fragment_length;
-				auto const rest_len = path_len - _fragment_length;
-				for (auto const &ch : _children) {
-					auto ret1 = ch->fast_find_internal(ctx, rest, rest_len);
-					if (ret1 || ctx.partial_matched_size > 0) {
-						return ret1; // partial or fully
-					}
+			if (self->_fragment_length < path_len) {
+				auto const *rest = path + self->_fragment_length;
+				auto const rest_len = path_len - self->_fragment_length;
+				if (auto *ch = child_of(self, *rest)) {
+					return fast_find_internal(ch, ctx, rest, rest_len); // partial or fully
 				}
 
 				ctx.partial_matched_size = cp;
-				ctx.ptr = this->weak_from_this();
+				ctx.ptr = self->weak_from_this();
 				return false;
 			}
-
-			// partial matched, and this node fully matched. for example:
-			// finding 'app.xmak' in node 'app.x' will return [5, thisnode, true].
-			// finding 'app.x' in node 'app.xmak' will return [5. thisnode, false].
-			ctx.partial_matched_size = path_len;
-			ctx.ptr = this->weak_from_this();
-			ctx.matched = true;
-			return true;
 		}
 
-		if (cp < _fragment_length) {
-			if (path_len < _fragment_length) {
-				ctx.partial_matched_size = cp;
-				ctx.ptr = this->weak_from_this();
-				// partial matched, and this node not matched. for example:
-				// finding 'app.x' in node 'app.xmak' will return [5. thisnode, false].
-				// finding 'app.xmak' in node 'app.x' will return [5, thisnode, true].
-				return false;
-			}
-
-			// frag_len < path_len
-			auto const *rest = path + cp;
-			auto const rest_len = path_len - cp;
-			for (auto const &ch : _children) {
-				auto ret1 = ch->fast_find_internal(ctx, rest, rest_len);
-				if (ret1 || ctx.partial_matched_size > 0) {
-					return ret1; // partial or fully
-				}
-			}
-
-			ctx.partial_matched_size = cp;
-			ctx.ptr = this->weak_from_this();
-			return false;
-		}
+		// partial matched, the path ends or diverges inside this
+		// fragment, so none of the children can match. for example:
+		// finding 'app.x' or 'app.xyz' in node 'app.xmak' will return
+		// [5. thisnode, false].
+		ctx.partial_matched_size = cp;
+		ctx.ptr = self->weak_from_this();
+		return false;
+	}
 
-		return ctx.matched;
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Self>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        child_of(Self *self, char first_byte) -> Self * {
+		auto const &chs = self->_children;
+		auto it = std::lower_bound(chs.begin(), chs.end(), first_byte, first_byte_less{});
+		if (it != chs.end() && (*it)->_fragment.front() == first_byte)
+			return static_cast<Self *>(it->get());
+		return nullptr;
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Self>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
-	        locate_internal(const char *path, weak_node_ptr parent) -> locate_return_s {
+	        locate_internal(Self *self, const char *path, weak_ptr_of<Self> parent) -> locate_return_of<Self> {
 		if (!path) {
 			return {};
 		}
 
-		auto const frag_len = _fragment_length;
+		auto const frag_len = self->_fragment_length;
 		if (frag_len == 0) {
 			// for root node only
-			auto wp_this = this->weak_from_this();
-			for (auto const &ch : _children) {
-				auto ret1 = ch->locate_internal(path, wp_this);
-				if (ret1.matched || ret1.partial_matched_size > 0) {
-					if (ret1.parents == nullptr)
-						ret1.parents = new std::vector<weak_node_ptr>{wp_this};
-					return ret1;
-				}
+			auto wp_this = self->weak_from_this();
+			if (auto *ch = child_of(self, *path)) {
+				auto ret1 = locate_internal(ch, path, wp_this);
+				if (ret1.parents == nullptr)
+					ret1.parents = new std::vector<weak_ptr_of<Self>>{wp_this};
+				return ret1;
 			}
 			return {};
 		}
 
 		auto path_len = std::strlen(path);
-		auto cp = common_prefix(_fragment.c_str(), frag_len, path, path_len);
+		auto cp = common_prefix(self->_fragment.c_str(), frag_len, path, path_len);
 		if (cp == 0) {
 			return {};
 		}
 
 		if (cp == frag_len) {
-			weak_node_ptr wp_this = this->weak_from_this();
+			weak_ptr_of<Self> wp_this = self->weak_from_this();
 			if (path_len == frag_len) {
-				auto *parents = new std::vector<weak_node_ptr>{parent};
+				auto *parents = new std::vector<weak_ptr_of<Self>>{parent};
 				return {0, wp_this, static_cast<errno_t>(0), true, parents};
 			}
 
 			if (path_len > frag_len) {
 				auto const *rest = path + frag_len;
-				for (auto const &ch : _children) {
-					auto ret1 = ch->locate_internal(rest, wp_this);
-					if (ret1.matched || ret1.partial_matched_size > 0) {
-						if (ret1.parents == nullptr)
-							ret1.parents = new std::vector<weak_node_ptr>{parent, wp_this};
-						return ret1; // partial or fully
-					}
-				}
-
-				auto *parents = new std::vector<weak_node_ptr>{parent};
-				return {cp, wp_this, 0, false, parents};
-			}
-
-			// partial matched, and this node fully matched. for example:
-			// finding 'app.xmak' in node 'app.x' will return [5, thisnode, true].
-			// finding 'app.x' in node 'app.xmak' will return [5. thisnode, false].
-			auto *parents = new std::vector<weak_node_ptr>{parent};
-			return {path_len, wp_this, 0, true, parents};
-		}
-
-		if (cp < frag_len) {
-			weak_node_ptr wp_this = this->weak_from_this();
-			if (path_len < frag_len) {
-				// partial matched, and this node not matched. for example:
-				// finding 'app.x' in node 'app.xmak' will return [5. thisnode, false].
-				// finding 'app.xmak' in node 'app.x' will return [5, thisnode, true].
-				auto *parents = new std::vector<weak_node_ptr>{parent};
-				return {cp, wp_this, 0, false, parents};
-			}
-
-			// frag_len < path_len
-			auto const *rest = path + cp;
-			for (auto const &ch : _children) {
-				auto ret1 = ch->locate_internal(rest, wp_this);
-				if (ret1.matched || ret1.partial_matched_size > 0) {
+				if (auto *ch = child_of(self, *rest)) {
+					auto ret1 = locate_internal(ch, rest, wp_this);
 					if (ret1.parents == nullptr)
-						ret1.parents = new std::vector<weak_node_ptr>{parent, wp_this};
+						ret1.parents = new std::vector<weak_ptr_of<Self>>{parent, wp_this};
 					return ret1; // partial or fully
 				}
-			}
 
-			auto *parents = new std::vector<weak_node_ptr>{parent};
-			return {cp, wp_this, 0, false, parents};
+				auto *parents = new std::vector<weak_ptr_of<Self>>{parent};
+				return {cp, wp_this, 0, false, parents};
+			}
 		}
 
-		return {};
+		// partial matched, the path ends or diverges inside this
+		// fragment, so none of the children can match. for example:
+		// finding 'app.x' or 'app.xyz' in node 'app.xmak' will return
+		// [5. thisnode, false].
+		weak_ptr_of<Self> wp_this = self->weak_from_this();
+		auto *parents = new std::vector<weak_ptr_of<Self>>{parent};
+		return {cp, wp_this, 0, false, parents};
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        search(const char *path) -> locate_return_s {
-		locate_return_s ret = this->locate_internal(path, weak_node_ptr{});
+		locate_return_s ret = locate_internal(this, path, weak_node_ptr{});
 		if (ret.matched == false) {
 			if (auto pos = ret.partial_matched_size > 0) {
 				if (auto sp = ret.ptr.lock()) {
@@ -1258,11 +2212,12 @@ namespace trie {
 	                      errno_t en) -> void {
 		(void) path;
 		if (node_ptr sp = nd_ptr.lock()) {
-			ret.old = sp->set_value(std::move(ret.old));
-			if (include_children) {
+			if (include_children || sp->_children.empty()) {
 				if (parents != nullptr) {
 					if (node_ptr dad = parents->back().lock()) {
+						ret.old = sp->set_value(std::move(ret.old));
 						dad->del(sp);
+						dad->compact();
 						ret.en = en;
 						ret.ok = true;
 						return;
@@ -1290,7 +2245,7 @@ namespace trie {
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        remove(char const *path, const bool include_children) -> return_s {
 		return_s ret{};
-		auto fr = locate_internal(path, weak_node_ptr{});
+		auto fr = locate_internal(this, path, weak_node_ptr{});
 		ret.en = fr.en;
 		if (fr.matched && fr.partial_matched_size == 0) {
 			// fully matched
@@ -1336,6 +2291,16 @@ namespace trie {
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        dump_r(std::ostream &os, std::stringstream &ss, const int level) const -> std::ostream & {
+		dump_line(ss, level);
+		for (auto const &ch : _children) {
+			ch->dump_r(os, ss, level + 1);
+		}
+		return os;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto node<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        dump_line(std::stringstream &ss, const int level) const -> void {
 		if (_fragment_length > 0) {
 			if (level > 0) {
 				ss << std::setw(level * 2) << ' ';
@@ -1354,11 +2319,6 @@ namespace trie {
 				ss << ' ' << ']';
 			ss << '\n';
 		}
-
-		for (auto const &ch : _children) {
-			ch->dump_r(os, ss, level + 1);
-		}
-		return os;
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
@@ -1399,7 +2359,7 @@ namespace trie {
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
 	        insert(std::string const &path, value_t &&value) -> return_s {
-		return _root->insert(path, value);
+		return _root->insert(path, std::move(value));
 	}
 
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
@@ -1445,8 +2405,10 @@ namespace trie {
 	        append(char const *path, value_t &&value) -> return_s {
 		if (auto ret = _root->search(path); ret.matched) {
 			if (auto sp = ret.ptr.lock()) {
-				auto old = sp->set_value(value); // TODO append value
-				return {old, 0, true};
+				return_s r{};
+				r.ok = true;
+				r.old = std::exchange(sp->value(), std::move(value)); // TODO append value
+				return r;
 			}
 		}
 		return {};
@@ -1459,7 +2421,7 @@ namespace trie {
 			if (auto sp = ret.ptr.lock()) {
 				return_s r{};
 				r.ok = true;
-				r.old = sp->set_value(value);
+				r.old = std::exchange(sp->value(), std::move(value));
 				return r;
 			}
 		}
@@ -1501,8 +2463,492 @@ namespace trie {
 		return _root;
 	}
 
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        export_keys(std::string &out, std::size_t restart_interval) const -> std::size_t {
+		// the keys come in byte order by a pre-order walk, and the prefix
+		// a key shares with the previous one is the path of their lowest
+		// common ancestor, the shortest parent path since that key.
+		frontcode::writer w(out, restart_interval);
+		std::size_t shared{};
+		_root->walk([&w, &shared](node_t const &nd, int, int) {
+			shared = std::min(shared, nd.path().size() - nd.fragment_length());
+			if (nd.type() == node_t::NODE_LEAF) {
+				w.add(nd.path(), shared);
+				shared = nd.path().size();
+			}
+		});
+		w.finish();
+		return w.count();
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Fn>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        import_keys(std::string_view data, Fn &&value_of) -> bool {
+		frontcode::reader r(data);
+		auto b = bulk();
+		std::string path;
+		return r.scan([&](std::string_view key, std::size_t) {
+			path.assign(key);
+			b.add(path, value_of(key));
+		});
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        set_weight(char const *path, weight_t weight) -> bool {
+		if (!path || !*path) return false;
+		auto fr = _root->fast_find(path);
+		auto sp = fr.ptr.lock();
+		return fr.matched && sp && sp->weight(weight);
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        clear_weight(char const *path) -> bool {
+		if (!path || !*path) return false;
+		auto fr = _root->fast_find(path);
+		auto sp = fr.ptr.lock();
+		if (!fr.matched || !sp || !sp->weighted()) return false;
+		sp->clear_weight();
+		return true;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        complete(char const *prefix, std::size_t k) const -> std::vector<completion_s> {
+		std::vector<completion_s> ret;
+		auto nd = prefix_node(prefix);
+		if (!nd || k == 0) return ret;
+		auto const &best = nd->best_completions();
+		if (k <= node_t::completion_cache_size || best.size() < node_t::completion_cache_size) {
+			// the cache holds all of the subtree if it is not full
+			ret.assign(best.begin(), best.begin() + std::ptrdiff_t(std::min(k, best.size())));
+			return ret;
+		}
+
+		// best-first over the caches: an item is the rest of the cache
+		// of a subtree from index on, or a single key if subtree is
+		// nullptr. Once a full cache is used up the subtree is expanded
+		// into its own key and its children, whose caches may repeat
+		// some keys already taken.
+		struct item {
+			completion_s rank;
+			node_t const *subtree;
+			std::size_t index;
+		};
+		auto worse = [](item const &a, item const &b) { return node_t::better(b.rank, a.rank); };
+		std::priority_queue<item, std::vector<item>, decltype(worse)> queue(worse);
+		std::unordered_set<node_t const *> taken;
+		queue.push({best.front(), nd.get(), 0});
+		while (!queue.empty() && ret.size() < k) {
+			auto const top = queue.top();
+			queue.pop();
+			if (taken.insert(top.rank.ptr).second) ret.push_back(top.rank);
+			if (!top.subtree) continue;
+
+			auto const &cache = top.subtree->best_completions();
+			if (top.index + 1 < cache.size()) {
+				queue.push({cache[top.index + 1], top.subtree, top.index + 1});
+				continue;
+			}
+			if (cache.size() < node_t::completion_cache_size) continue; // the whole subtree was cached
+			if (top.subtree->type() == node_t::NODE_LEAF && top.subtree->weighted())
+				queue.push({{top.subtree, top.subtree->weight()}, nullptr, 0});
+			for (auto const &ch : top.subtree->children()) {
+				if (auto const &b = ch->best_completions(); !b.empty()) queue.push({b.front(), ch.get(), 0});
+			}
+		}
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        prefix_node(char const *prefix) const -> const_node_ptr {
+		const_node_ptr nd = _root;
+		if (!prefix) return nd;
+		auto const *rest = prefix;
+		auto rest_len = std::strlen(prefix);
+		while (rest_len > 0) {
+			auto const *ch = nd->child(*rest);
+			if (!ch) return nullptr;
+			auto const cp = common_prefix(ch->fragment().c_str(), ch->fragment_length(), rest, rest_len);
+			if (cp == rest_len) return ch->shared_from_this(); // prefix ends inside or at the end of ch
+			if (cp < ch->fragment_length()) return nullptr;    // diverged inside ch
+			nd = ch->shared_from_this();
+			rest += cp;
+			rest_len -= cp;
+		}
+		return nd;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        longest_match_internal(std::string_view query, bool aligned) const -> const_prefix_match_s {
+		const_prefix_match_s ret;
+		if (!_root) return ret;
+
+		node_t const *nd = _root.get();
+		std::size_t pos{0};
+		while (pos < query.size()) {
+			auto const *ch = nd->child(query[pos]);
+			if (!ch) break;
+			// the key of ch shall be a prefix of query, a partial match
+			// inside its fragment cannot reach any deeper key.
+			auto const &frag = ch->fragment();
+			if (frag.size() > query.size() - pos || query.compare(pos, frag.size(), frag) != 0) break;
+			pos += frag.size();
+			nd = ch;
+			if (nd->type() != node_t::NODE_LEAF) continue;
+			if (aligned && pos < query.size() && query[pos] != delimiter && query[pos - 1] != delimiter) continue;
+			ret.ptr = nd;
+			ret.matched_length = pos;
+			ret.matched = true;
+		}
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        fuzzy_find(std::string_view query, std::size_t max_edits) const -> std::vector<fuzzy_match_s> {
+		std::vector<fuzzy_match_s> ret;
+		if (!_root) return ret;
+
+		// rows[d * width + j] is the distance between the first d bytes
+		// of the path and the first j bytes of query.
+		auto const width = query.size() + 1;
+		std::vector<std::size_t> rows(width * 16);
+		for (std::size_t j = 0; j < width; j++) rows[j] = j;
+
+		// a depth-first walk, so that the rows of a node stay in place
+		// until its subtree is done. The children to visit of the nodes
+		// on the stack are kept in pending, in the order of their keys.
+		struct frame {
+			std::size_t depth; // bytes of the path of the node
+			std::size_t begin, next, end;
+		};
+		std::vector<frame> stack;
+		std::vector<node_t const *> pending;
+		std::string bytes;
+		auto expand = [&](node_t const *nd, std::size_t depth, std::size_t row_min) {
+			auto const begin = pending.size();
+			if (row_min < max_edits) {
+				for (auto const &ch : nd->children()) pending.push_back(ch.get());
+			} else {
+				// no edit is left, a path can only go on with the rest
+				// of query after a cell of max_edits, so look up those
+				// children instead of visiting all of them.
+				auto const *row = rows.data() + depth * width;
+				bytes.clear();
+				for (std::size_t j = 0; j < query.size(); j++) {
+					if (row[j] == max_edits) bytes += query[j];
+				}
+				std::sort(bytes.begin(), bytes.end(), [](char a, char b) {
+					return static_cast<unsigned char>(a) < static_cast<unsigned char>(b);
+				});
+				bytes.erase(std::unique(bytes.begin(), bytes.end()), bytes.end());
+				for (auto c : bytes) {
+					if (auto const *ch = nd->child(c)) pending.push_back(ch);
+				}
+			}
+			if (pending.size() > begin) stack.push_back({depth, begin, begin, pending.size()});
+		};
+
+		expand(_root.get(), 0, 0);
+		while (!stack.empty()) {
+			auto &top = stack.back();
+			if (top.next == top.end) {
+				pending.resize(top.begin);
+				stack.pop_back();
+				continue;
+			}
+			auto const *ch = pending[top.next++];
+			auto const &frag = ch->fragment();
+			auto depth = top.depth;
+			if (rows.size() < (depth + frag.size() + 1) * width)
+				rows.resize((depth + frag.size() + 1) * width * 2);
+
+			auto best = max_edits + 1; // the minimum of the last row
+			for (auto c : frag) {
+				auto const *prev = rows.data() + depth * width;
+				auto *row = rows.data() + (depth + 1) * width;
+				row[0] = best = prev[0] + 1;
+				for (std::size_t j = 1; j < width; j++) {
+					row[j] = std::min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (query[j - 1] != c)});
+					best = std::min(best, row[j]);
+				}
+				depth++;
+				if (best > max_edits) break;
+			}
+			if (best > max_edits) continue; // no key below can be near enough
+
+			auto const distance = rows[depth * width + width - 1];
+			if (ch->type() == node_t::NODE_LEAF && distance <= max_edits)
+				ret.push_back({ch, distance});
+			if (!ch->children().empty())
+				expand(ch, depth, best); // top is invalidated from here
+		}
+		std::stable_sort(ret.begin(), ret.end(), [](auto const &a, auto const &b) { return a.distance < b.distance; });
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Fn>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        match_internal(query::automaton &a, Fn &fn) const -> void {
+		if (!_root) return;
+
+		// the same depth-first walk as fuzzy_find(), a frame holds the
+		// automaton state at the end of its node.
+		using state_t = query::automaton::state_t;
+		struct frame {
+			state_t state;
+			std::size_t begin, next, end;
+		};
+		std::vector<frame> stack;
+		std::vector<node_t const *> pending;
+		auto expand = [&](node_t const *nd, state_t state) {
+			auto const begin = pending.size();
+			if (auto const *bytes = a.narrow(state)) {
+				for (auto c : *bytes) {
+					if (auto const *ch = nd->child(c)) pending.push_back(ch);
+				}
+			} else {
+				for (auto const &ch : nd->children()) pending.push_back(ch.get());
+			}
+			if (pending.size() > begin) stack.push_back({state, begin, begin, pending.size()});
+		};
+		// keep the states of the frames and the current one over a flush
+		std::vector<state_t> live;
+		auto flush = [&](state_t &state) {
+			live.clear();
+			for (auto const &f : stack) live.push_back(f.state);
+			live.push_back(state);
+			a.flush(live);
+			for (std::size_t i = 0; i < stack.size(); i++) stack[i].state = live[i];
+			state = live.back();
+		};
+
+		expand(_root.get(), a.start());
+		while (!stack.empty()) {
+			auto &top = stack.back();
+			if (top.next == top.end) {
+				pending.resize(top.begin);
+				stack.pop_back();
+				continue;
+			}
+			auto const *ch = pending[top.next++];
+			auto state = top.state;
+			for (auto c : ch->fragment()) {
+				if (a.full()) flush(state);
+				if ((state = a.next(state, static_cast<unsigned char>(c))) == query::automaton::dead) break;
+			}
+			if (state == query::automaton::dead) continue;
+
+			if (ch->type() == node_t::NODE_LEAF && a.accepting(state)) fn(*ch);
+			if (!ch->children().empty()) expand(ch, state); // top is invalidated from here
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        rank(char const *key) const -> std::size_t {
+		std::size_t ret{0};
+		if (!key || !_root) return ret;
+
+		node_t const *nd = _root.get();
+		auto const *rest = key;
+		auto rest_len = std::strlen(key);
+		for (;;) {
+			// the path of nd is a proper prefix of key, or equals to it
+			if (rest_len == 0) return ret;
+			if (nd->type() == node_t::NODE_LEAF) ret++;
+
+			node_t const *next{};
+			for (auto const &chp : nd->children()) {
+				auto const *ch = chp.get();
+				auto const c = static_cast<unsigned char>(ch->fragment().front());
+				auto const r = static_cast<unsigned char>(*rest);
+				if (c < r) {
+					ret += ch->leaves();
+					continue;
+				}
+				if (c > r) return ret;
+
+				auto const frag_len = ch->fragment_length();
+				auto const cp = common_prefix(ch->fragment().c_str(), frag_len, rest, rest_len);
+				if (cp == frag_len) {
+					next = ch;
+					rest += cp;
+					rest_len -= cp;
+					break;
+				}
+				// key ends or diverges inside the fragment of ch
+				if (cp < rest_len && static_cast<unsigned char>(ch->fragment()[cp]) < static_cast<unsigned char>(rest[cp]))
+					ret += ch->leaves();
+				return ret;
+			}
+			if (!next) return ret;
+			nd = next;
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        select(std::size_t i) const -> const_node_ptr {
+		if (i >= size()) return nullptr;
+
+		node_t const *nd = _root.get();
+		for (;;) {
+			if (nd->type() == node_t::NODE_LEAF) {
+				if (i == 0) return nd->shared_from_this();
+				i--;
+			}
+			node_t const *next{};
+			for (auto const &ch : nd->children()) {
+				if (i < ch->leaves()) {
+					next = ch.get();
+					break;
+				}
+				i -= ch->leaves();
+			}
+			if (!next) return nullptr; // unreachable while the leaf counts are consistent
+			nd = next;
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        begin() const -> const_iterator {
+		const_iterator it{_root.get()};
+		it._stack.push_back({_root.get(), 0});
+		return it.settle();
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        lower_bound(char const *key) const -> const_iterator {
+		const_iterator it{_root.get()};
+		it._stack.push_back({_root.get(), 0});
+		if (!key) return it.settle();
+
+		auto const *rest = key;
+		auto rest_len = std::strlen(key);
+		for (;;) {
+			// the path of the top is a proper prefix of key, or equals to it
+			if (rest_len == 0) return it.settle();
+
+			auto const &children = it._stack.back().nd->children();
+			auto const pos = std::size_t(std::lower_bound(children.begin(), children.end(), *rest, typename node_t::first_byte_less{}) - children.begin());
+			if (pos == children.size()) {
+				// all keys in this subtree are less than key
+				it.skip_subtree();
+				return it.settle();
+			}
+
+			it.push(pos);
+			auto const *ch = children[pos].get();
+			if (ch->fragment().front() != *rest) return it.settle(); // greater
+
+			auto const frag_len = ch->fragment_length();
+			auto const cp = common_prefix(ch->fragment().c_str(), frag_len, rest, rest_len);
+			if (cp == frag_len) {
+				rest += cp;
+				rest_len -= cp;
+				continue;
+			}
+			// key ends or diverges inside the fragment of ch
+			if (cp < rest_len && static_cast<unsigned char>(ch->fragment()[cp]) < static_cast<unsigned char>(rest[cp]))
+				it.skip_subtree();
+			return it.settle();
+		}
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        upper_bound(char const *key) const -> const_iterator {
+		auto it = lower_bound(key);
+		if (key && it != end() && it.key() == key) ++it;
+		return it;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        split_ranges(std::size_t k) const -> std::vector<key_range> {
+		std::vector<key_range> ret;
+		auto const n = size();
+		if (k == 0 || n == 0) return ret;
+		k = std::min(k, n);
+		ret.reserve(k);
+		for (std::size_t j = 0; j < k; j++) {
+			auto const lo = j * n / k, hi = (j + 1) * n / k;
+			ret.push_back({lo, hi - lo, select(lo)->path(), select(hi - 1)->path()});
+		}
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	template<typename Node>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        scan_prefix_internal(Node *root, std::string prefix)
+	                -> generator<scan_result<std::conditional_t<std::is_const_v<Node>, value_t const, value_t>>> {
+		using value_ref = std::conditional_t<std::is_const_v<Node>, value_t const, value_t> &;
+		if (!root) co_return;
+
+		// children(): the node_ptr's are not const, so a non-const
+		// scan reaches mutable nodes without casting
+		auto child_of = [](Node *nd, char c) -> Node * {
+			auto const &chs = nd->children();
+			auto it = std::lower_bound(chs.begin(), chs.end(), c, typename node_t::first_byte_less{});
+			return it != chs.end() && (*it)->fragment().front() == c ? it->get() : nullptr;
+		};
+
+		// descend to the topmost node holding prefix
+		std::string key;
+		key.reserve(std::max<std::size_t>(prefix.size() * 2, 64));
+		Node *nd = root;
+		for (std::string_view rest{prefix}; !rest.empty();) {
+			auto *ch = child_of(nd, rest.front());
+			if (!ch) co_return;
+			auto const &frag = ch->fragment();
+			auto const cp = common_prefix(frag.c_str(), frag.size(), rest.data(), rest.size());
+			if (cp < rest.size() && cp < frag.size()) co_return; // diverged inside ch
+			key += frag;
+			rest.remove_prefix(std::min(cp, rest.size()));
+			nd = ch;
+		}
+
+		if (nd->type() == node_t::NODE_LEAF)
+			co_yield scan_result<std::remove_reference_t<value_ref>>{key, nd->value()};
+
+		struct frame {
+			Node *nd;
+			std::size_t next;    // the next child to visit
+			std::size_t key_len; // length of the key of nd
+		};
+		std::vector<frame> stack{{nd, 0, key.size()}};
+		while (!stack.empty()) {
+			auto &top = stack.back();
+			auto const &chs = top.nd->children();
+			if (top.next == chs.size()) {
+				stack.pop_back();
+				continue;
+			}
+			Node *ch = chs[top.next++].get();
+			key.resize(top.key_len);
+			key += ch->fragment();
+			if (ch->type() == node_t::NODE_LEAF)
+				co_yield scan_result<std::remove_reference_t<value_ref>>{key, ch->value()};
+			if (!ch->children().empty())
+				stack.push_back({ch, 0, key.size()});
+		}
+	}
+
 	/**
 	 * @brief return how many leaves in this tree.
+	 * @details Each node maintains the leaf count of its subtree, so
+	 * this is O(1).
 	 * @tparam ValueT
 	 * @tparam TagT
 	 * @tparam delimiter
@@ -1510,15 +2956,14 @@ namespace trie {
 	 */
 	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
 	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::size() const -> std::size_t {
-		int count{0};
-		if (_root) {
-			_root->walk([&count](node_type type, const_node_ptr n, int, int) {
-				if (type == node_t::NODE_LEAF) count++;
-				(void) n;
-			});
-			// return _root->children_count();
-		}
-		return count;
+		return _root ? _root->leaves() : 0;
+	}
+
+	template<typename ValueT, char delimiter, typename DescT, typename CommentT, typename TagT, typename ExtPkgT>
+	inline auto trie_t<ValueT, delimiter, DescT, CommentT, TagT, ExtPkgT>::
+	        count_prefix(char const *prefix) const -> std::size_t {
+		if (auto nd = prefix_node(prefix)) return nd->leaves();
+		return 0;
 	}
 } // namespace trie
 
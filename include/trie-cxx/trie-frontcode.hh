@@ -0,0 +1,259 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_FRONTCODE_HH
+#define TRIE_CXX_TRIE_FRONTCODE_HH
+
+#include <algorithm>
+#include <type_traits>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// The front-coded key format: a sorted set of keys, each stored as
+// the length it shares with the previous key and the rest of it.
+// Every restart_interval keys a key is stored whole, a restart point,
+// so a lookup binary-searches the restart points and then decodes
+// one block only.
+//
+//    "TFC1"
+//    entries:   varint shared, varint length of suffix, suffix bytes
+//    restarts:  u32 offset of each restart entry
+//    trailer:   u32 restart count, u32 key count, u32 restart_interval
+//
+// The integers of the index and trailer are little-endian.
+namespace trie::frontcode {
+	static constexpr char magic[4] = {'T', 'F', 'C', '1'};
+	static constexpr std::size_t trailer_size = 12;
+
+	namespace detail {
+		// write v at p, return the end of it; 10 bytes at most
+		inline auto put_varint(char *p, std::size_t v) -> char * {
+			for (; v >= 0x80; v >>= 7) *p++ = static_cast<char>((v & 0x7f) | 0x80);
+			*p++ = static_cast<char>(v);
+			return p;
+		}
+		// read a varint at pos, false if it runs past end
+		inline auto get_varint(std::string_view in, std::size_t &pos, std::size_t &v) -> bool {
+			v = 0;
+			for (unsigned shift = 0; pos < in.size() && shift < 64; shift += 7) {
+				auto const b = static_cast<unsigned char>(in[pos++]);
+				v |= std::size_t(b & 0x7f) << shift;
+				if (!(b & 0x80)) return true;
+			}
+			return false;
+		}
+		inline auto put_u32(std::string &out, std::uint32_t v) -> void {
+			for (int i = 0; i < 4; i++) out += static_cast<char>((v >> (i * 8)) & 0xff);
+		}
+		inline auto get_u32(std::string_view in, std::size_t pos) -> std::uint32_t {
+			std::uint32_t v{};
+			for (int i = 3; i >= 0; i--) v = (v << 8) | static_cast<unsigned char>(in[pos + std::size_t(i)]);
+			return v;
+		}
+	} // namespace detail
+
+	/**
+	 * @brief writer appends keys in strictly increasing byte order to
+	 * a front-coded buffer.
+	 * @code
+	 * std::string buf;
+	 * trie::frontcode::writer w(buf);
+	 * w.add("app.logging.file"), w.add("app.logging.level");
+	 * w.finish();
+	 * @endcode
+	 */
+	class writer {
+	public:
+		explicit writer(std::string &out, std::size_t restart_interval = 16)
+		    : _out(out)
+		    , _interval(std::max<std::size_t>(1, restart_interval)) {
+			_out.append(magic, sizeof(magic));
+		}
+
+		/**
+		 * @brief add the next key.
+		 * @return false if key is not greater than the previous one
+		 */
+		auto add(std::string_view key) -> bool {
+			auto const n = std::min(_last.size(), key.size());
+			auto shared = std::size_t(std::mismatch(_last.data(), _last.data() + n, key.data()).first - _last.data());
+			if (_count > 0) {
+				// the order, from the byte following the common prefix
+				bool const greater = shared < n ? static_cast<unsigned char>(key[shared]) > static_cast<unsigned char>(_last[shared])
+				                                : key.size() > _last.size();
+				if (!greater) return false;
+			}
+			append(key, shared);
+			return true;
+		}
+		/**
+		 * @brief add the next key, which the caller knows to be greater
+		 * than the previous one and to share shared bytes with it, for
+		 * example from the structure of a trie; neither is checked.
+		 */
+		auto add(std::string_view key, std::size_t shared) -> void { append(key, shared); }
+
+		// write the index, no key can be added after it
+		auto finish() -> void {
+			for (auto r : _restarts) detail::put_u32(_out, r);
+			detail::put_u32(_out, std::uint32_t(_restarts.size()));
+			detail::put_u32(_out, std::uint32_t(_count));
+			detail::put_u32(_out, std::uint32_t(_interval));
+		}
+
+		auto count() const -> std::size_t { return _count; }
+
+	private:
+		auto append(std::string_view key, std::size_t shared) -> void {
+			if (_count % _interval == 0) {
+				_restarts.push_back(std::uint32_t(_out.size()));
+				shared = 0;
+			}
+			char head[20];
+			auto *end = detail::put_varint(detail::put_varint(head, shared), key.size() - shared);
+			_out.append(head, end).append(key.substr(shared));
+			_last.assign(key);
+			_count++;
+		}
+
+	private:
+		std::string &_out;
+		std::size_t _interval;
+		std::size_t _count{};
+		std::string _last{};
+		std::vector<std::uint32_t> _restarts{};
+	}; // class writer
+
+	/**
+	 * @brief reader decodes a front-coded buffer in place, without
+	 * copying it.
+	 * @details The buffer is checked when it is opened: the magic, the
+	 * trailer and the restart offsets; an entry running out of its
+	 * bounds stops the scan, which then returns false.
+	 */
+	class reader {
+	public:
+		reader() = default;
+		explicit reader(std::string_view data) { open(data); }
+
+		// false if data is not a front-coded buffer
+		auto open(std::string_view data) -> bool {
+			_valid = false;
+			if (data.size() < sizeof(magic) + trailer_size || std::memcmp(data.data(), magic, sizeof(magic)) != 0) return false;
+			auto const tail = data.size() - trailer_size;
+			auto const restarts = std::size_t(detail::get_u32(data, tail));
+			_count = detail::get_u32(data, tail + 4);
+			_interval = detail::get_u32(data, tail + 8);
+			if (restarts > (tail - sizeof(magic)) / 4 || _interval == 0) return false;
+			if (restarts != (_count + _interval - 1) / _interval) return false;
+			_data = data;
+			_entries_end = tail - restarts * 4;
+			_restart_count = restarts;
+			for (std::size_t i = 0; i < restarts; i++) {
+				auto const off = restart(i);
+				if (off < sizeof(magic) || off >= _entries_end || (i > 0 && off <= restart(i - 1))) return false;
+			}
+			_valid = true;
+			return true;
+		}
+		auto valid() const -> bool { return _valid; }
+		auto size() const -> std::size_t { return _count; } // count of keys
+
+		/**
+		 * @brief call fn(std::string_view key, std::size_t shared) for
+		 * each key in order, from the first key not less than from.
+		 * @details shared is the length of the prefix key has in common
+		 * with the previous key called back (0 for the first one, it may
+		 * be less than the real common prefix at a restart point). fn
+		 * may return false to stop.
+		 * @return false if the buffer is corrupt
+		 */
+		template<typename Fn>
+		auto scan(std::string_view from, Fn &&fn) const -> bool {
+			if (!_valid) return false;
+			if (_restart_count == 0) return true;
+			// the last restart whose key is less than from
+			std::size_t lo{0}, hi{_restart_count};
+			while (hi - lo > 1) {
+				auto const mid = lo + (hi - lo) / 2;
+				std::string_view key;
+				if (!restart_key(mid, key)) return false;
+				if (key < from)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			std::string key;
+			bool started{false};
+			auto const entries = _data.substr(0, _entries_end);
+			for (std::size_t pos = restart(lo), i = lo * _interval; i < _count; i++) {
+				std::size_t shared{}, length{};
+				if (!detail::get_varint(entries, pos, shared) || !detail::get_varint(entries, pos, length)) return false;
+				if (shared > key.size() || length > _entries_end - pos) return false;
+				key.resize(shared);
+				key.append(_data.substr(pos, length));
+				pos += length;
+				if (!started) {
+					if (key < from) continue;
+					started = true;
+					shared = 0;
+				}
+				if constexpr (std::is_same_v<std::invoke_result_t<Fn &, std::string_view, std::size_t>, bool>) {
+					if (!fn(std::string_view{key}, shared)) return true;
+				} else {
+					fn(std::string_view{key}, shared);
+				}
+			}
+			return true;
+		}
+		template<typename Fn>
+		auto scan(Fn &&fn) const -> bool { return scan(std::string_view{}, std::forward<Fn>(fn)); }
+
+		// whether key is in the set, decoding one block at most
+		auto contains(std::string_view key) const -> bool {
+			bool found{false};
+			scan(key, [&found, key](std::string_view k, std::size_t) {
+				found = k == key;
+				return false;
+			});
+			return found;
+		}
+
+	private:
+		auto restart(std::size_t i) const -> std::size_t { return detail::get_u32(_data, _entries_end + i * 4); }
+		// a restart entry holds its whole key
+		auto restart_key(std::size_t i, std::string_view &key) const -> bool {
+			auto const entries = _data.substr(0, _entries_end);
+			std::size_t pos = restart(i), shared{}, length{};
+			if (!detail::get_varint(entries, pos, shared) || !detail::get_varint(entries, pos, length)) return false;
+			if (shared != 0 || length > _entries_end - pos) return false;
+			key = _data.substr(pos, length);
+			return true;
+		}
+
+	private:
+		std::string_view _data{};
+		std::size_t _entries_end{};
+		std::size_t _restart_count{};
+		std::size_t _count{};
+		std::size_t _interval{1};
+		bool _valid{};
+	}; // class reader
+} // namespace trie::frontcode
+
+#endif // TRIE_CXX_TRIE_FRONTCODE_HH
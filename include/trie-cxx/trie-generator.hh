@@ -0,0 +1,142 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_GENERATOR_HH
+#define TRIE_CXX_TRIE_GENERATOR_HH
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace trie {
+	/**
+	 * @brief generator is a lazy, single-pass range produced by a
+	 * coroutine, a subset of C++23 std::generator.
+	 * @details The coroutine runs only when the range is iterated,
+	 * up to the next co_yield. The yielded object is not copied: the
+	 * reference returned by the iterator refers to it, and it stays
+	 * valid until the iterator is incremented. Breaking out of the
+	 * loop and destroying the generator stops the coroutine.
+	 * @code{c++}
+	 * auto numbers() -> trie::generator<int> {
+	 *   for (int i = 0;; i++) co_yield i;
+	 * }
+	 * for (auto n : numbers()) {
+	 *   if (n > 10) break;
+	 * }
+	 * @endcode
+	 * @tparam T the yielded type
+	 */
+	template<typename T>
+	class generator {
+	public:
+		using value_type = std::remove_cvref_t<T>;
+		using reference = std::conditional_t<std::is_reference_v<T>, T, T &>;
+		using pointer = std::add_pointer_t<reference>;
+
+		struct promise_type {
+			pointer _value{};
+			std::exception_ptr _ex{};
+
+			auto get_return_object() -> generator {
+				return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+			}
+			auto initial_suspend() noexcept -> std::suspend_always { return {}; }
+			auto final_suspend() noexcept -> std::suspend_always { return {}; }
+			auto yield_value(std::remove_reference_t<reference> &v) noexcept -> std::suspend_always {
+				_value = std::addressof(v);
+				return {};
+			}
+			auto yield_value(std::remove_reference_t<reference> &&v) noexcept -> std::suspend_always {
+				// the temporary lives until the coroutine is resumed
+				_value = std::addressof(v);
+				return {};
+			}
+			auto return_void() noexcept -> void {}
+			auto unhandled_exception() -> void { _ex = std::current_exception(); }
+
+			template<typename U>
+			auto await_transform(U &&) -> std::suspend_never = delete; // co_await is not supported
+		};
+
+		class iterator {
+		public:
+			using iterator_category = std::input_iterator_tag;
+			using value_type = generator::value_type;
+			using difference_type = std::ptrdiff_t;
+			using reference = generator::reference;
+
+			iterator() = default;
+
+			auto operator*() const -> reference { return static_cast<reference>(*_h.promise()._value); }
+			auto operator->() const -> pointer { return _h.promise()._value; }
+			auto operator++() -> iterator & {
+				resume(_h);
+				return *this;
+			}
+			auto operator++(int) -> void { ++*this; }
+
+			friend auto operator==(iterator const &it, std::default_sentinel_t) -> bool { return !it._h || it._h.done(); }
+
+		private:
+			friend class generator;
+			explicit iterator(std::coroutine_handle<promise_type> h)
+			    : _h(h) {}
+			std::coroutine_handle<promise_type> _h{};
+		};
+
+		generator() = default;
+		generator(generator &&o) noexcept
+		    : _h(std::exchange(o._h, {})) {}
+		auto operator=(generator &&o) noexcept -> generator & {
+			if (this != &o) {
+				if (_h) _h.destroy();
+				_h = std::exchange(o._h, {});
+			}
+			return *this;
+		}
+		generator(generator const &) = delete;
+		auto operator=(generator const &) -> generator & = delete;
+		~generator() {
+			if (_h) _h.destroy();
+		}
+
+		/**
+		 * @brief start the coroutine, run it to the first co_yield.
+		 * It can be called once only.
+		 */
+		auto begin() -> iterator {
+			if (_h) resume(_h);
+			return iterator{_h};
+		}
+		auto end() noexcept -> std::default_sentinel_t { return {}; }
+
+	private:
+		explicit generator(std::coroutine_handle<promise_type> h)
+		    : _h(h) {}
+
+		static auto resume(std::coroutine_handle<promise_type> h) -> void {
+			h.resume();
+			if (h.done() && h.promise()._ex)
+				std::rethrow_exception(std::exchange(h.promise()._ex, {}));
+		}
+
+	private:
+		std::coroutine_handle<promise_type> _h{};
+	}; // class generator<T>
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_GENERATOR_HH
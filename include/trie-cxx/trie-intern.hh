@@ -0,0 +1,135 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_INTERN_HH
+#define TRIE_CXX_TRIE_INTERN_HH
+
+#include <algorithm>
+#include <memory>
+
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// intern_pool
+namespace trie {
+	/**
+	 * @brief intern_pool stores each distinct string once and names it
+	 * by a 32-bit id, so that equal strings are compared as integers.
+	 * @details The bytes are appended to 64KB blocks (a longer string
+	 * gets a block of its own) which are never moved or freed before
+	 * the pool, so view() stays valid for the life of the pool. The
+	 * ids are indexed by an open-addressing table of their hashes,
+	 * at most half full. The pool is not thread-safe.
+	 * @code{c++}
+	 * trie::intern_pool pool;
+	 * auto a = pool.intern("timeout"), b = pool.intern("timeout");
+	 * assert(a == b && pool.view(a) == "timeout");
+	 * @endcode
+	 */
+	class intern_pool {
+	public:
+		using id_t = std::uint32_t;
+		using hash_t = std::uint64_t;
+		static constexpr id_t npos = ~id_t{0};
+		static constexpr std::size_t block_size = 64 * 1024;
+
+		intern_pool() = default;
+		~intern_pool() = default;
+		intern_pool(intern_pool const &) = delete;
+		intern_pool &operator=(intern_pool const &) = delete;
+		intern_pool(intern_pool &&) noexcept = default;
+		intern_pool &operator=(intern_pool &&) noexcept = default;
+
+		// FNV-1a
+		static auto hash_of(std::string_view s) -> hash_t {
+			hash_t h{0xcbf29ce484222325ull};
+			for (auto c : s) h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+			return h;
+		}
+
+		// the id of s, added if it is new
+		auto intern(std::string_view s) -> id_t {
+			auto const h = hash_of(s);
+			if (auto id = find(s, h); id != npos) return id;
+			if (_table.size() < (_views.size() + 1) * 2) rehash(std::max<std::size_t>(64, _table.size() * 2));
+			auto const id = id_t(_views.size());
+			_views.push_back(store(s));
+			_hashes.push_back(h);
+			place(id);
+			return id;
+		}
+		// the id of s, npos if it was never interned
+		auto find(std::string_view s) const -> id_t { return find(s, hash_of(s)); }
+		auto view(id_t id) const -> std::string_view { return _views[id]; }
+
+		auto size() const -> std::size_t { return _views.size(); } // count of distinct strings
+		auto bytes() const -> std::size_t { return _bytes; }       // total length of the distinct strings
+
+	private:
+		auto find(std::string_view s, hash_t h) const -> id_t {
+			if (_table.empty()) return npos;
+			auto const mask = _table.size() - 1;
+			for (auto i = std::size_t(h) & mask;; i = (i + 1) & mask) {
+				auto const id = _table[i];
+				if (id == npos) return npos;
+				if (_hashes[id] == h && _views[id] == s) return id;
+			}
+		}
+
+		auto store(std::string_view s) -> std::string_view {
+			_bytes += s.size();
+			if (s.empty()) return {};
+			if (s.size() > block_size / 4) {
+				// a long string gets a block of its own
+				_blocks.push_back(std::make_unique<char[]>(s.size()));
+				std::memcpy(_blocks.back().get(), s.data(), s.size());
+				return {_blocks.back().get(), s.size()};
+			}
+			if (s.size() > _left) {
+				_blocks.push_back(std::make_unique<char[]>(block_size));
+				_cursor = _blocks.back().get();
+				_left = block_size;
+			}
+			std::memcpy(_cursor, s.data(), s.size());
+			std::string_view ret{_cursor, s.size()};
+			_cursor += s.size();
+			_left -= s.size();
+			return ret;
+		}
+
+		auto rehash(std::size_t capacity) -> void {
+			_table.assign(capacity, npos);
+			for (id_t id = 0; id < _views.size(); id++) place(id);
+		}
+		auto place(id_t id) -> void {
+			auto const mask = _table.size() - 1;
+			auto i = std::size_t(_hashes[id]) & mask;
+			while (_table[i] != npos) i = (i + 1) & mask;
+			_table[i] = id;
+		}
+
+	private:
+		std::vector<std::unique_ptr<char[]>> _blocks{};
+		char *_cursor{}; // the free bytes of the block being filled
+		std::size_t _left{};
+		std::size_t _bytes{};
+		std::vector<std::string_view> _views{}; // by id
+		std::vector<hash_t> _hashes{};          // by id
+		std::vector<id_t> _table{};             // ids by hash, npos if empty
+	}; // class intern_pool
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_INTERN_HH
@@ -0,0 +1,244 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_KEYGEN_HH
+#define TRIE_CXX_TRIE_KEYGEN_HH
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+// Synthetic key sets and query traces, for benchmarks and load tests
+// which need the shape of a production trie without its data. All of
+// them are made from a seed only, so a key set is reproduced exactly
+// anywhere from its parameters: the draws use the raw output of
+// std::mt19937_64 only, which the standard fixes, and never the
+// distributions or std::shuffle, which it leaves to the library. The
+// Zipf weights take std::pow, which the common libms round alike.
+namespace trie::keygen {
+	// a double in [0, 1), from the high 53 bits of a draw
+	inline auto unit(std::mt19937_64 &rng) -> double { return double(rng() >> 11) * 0x1p-53; }
+
+	// Fisher-Yates
+	template<typename It>
+	inline auto shuffle(It first, It last, std::mt19937_64 &rng) -> void {
+		for (auto n = std::size_t(last - first); n > 1; n--)
+			std::iter_swap(first + (n - 1), first + std::ptrdiff_t(rng() % n));
+	}
+
+	/**
+	 * @brief zipf draws an index in [0, n) with probability
+	 * proportional to 1/(i+1)^s; s = 0 is uniform.
+	 */
+	class zipf {
+	public:
+		zipf(std::size_t n, double s)
+		    : _cdf(std::max<std::size_t>(n, 1)) {
+			double sum{0};
+			for (std::size_t i = 0; i < _cdf.size(); i++) {
+				sum += 1.0 / std::pow(double(i + 1), s);
+				_cdf[i] = sum;
+			}
+			for (auto &c : _cdf) c /= sum;
+		}
+		auto operator()(std::mt19937_64 &rng) const -> std::size_t {
+			auto const u = unit(rng);
+			auto it = std::lower_bound(_cdf.begin(), _cdf.end(), u);
+			return std::min<std::size_t>(std::size_t(it - _cdf.begin()), _cdf.size() - 1);
+		}
+
+	private:
+		std::vector<double> _cdf;
+	};
+
+	enum class length_dist {
+		uniform,   // segment lengths evenly in [min_segment, max_segment]
+		geometric, // mostly short segments, halving in frequency per extra byte
+	};
+
+	/**
+	 * @brief the shape of a key set.
+	 * @details The keys are paths in a virtual tree: the node at level
+	 * i has fanout[i] children (the last value repeats for deeper
+	 * levels), each named by a segment derived from the seed and its
+	 * position, so the same child always gets the same name. A key
+	 * takes min_depth to max_depth segments.
+	 *
+	 * shared_prefix is the chance that a key goes on from a random
+	 * ancestor of the previous key instead of from the root, which
+	 * gives neighbours longer common prefixes, as in a config file.
+	 * segment_skew concentrates the choice of children on the first
+	 * ones of each node by a Zipf law, 0 being uniform.
+	 */
+	struct shape {
+		std::size_t count{10000};
+		std::size_t min_depth{2};
+		std::size_t max_depth{5};
+		std::vector<std::size_t> fanout{8, 16, 32};
+		std::size_t min_segment{3};
+		std::size_t max_segment{10};
+		length_dist lengths{length_dist::uniform};
+		double shared_prefix{0.5};
+		double segment_skew{0};
+		char delimiter{'.'};
+		std::uint64_t seed{1};
+	};
+
+	namespace detail {
+		inline auto mix(std::uint64_t x) -> std::uint64_t { // splitmix64
+			x += 0x9e3779b97f4a7c15ull;
+			x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+			x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+			return x ^ (x >> 31);
+		}
+
+		// the name of child `index` of the node `parent`
+		inline auto segment(shape const &sh, std::uint64_t parent, std::size_t index) -> std::string {
+			auto h = mix(parent ^ mix(index + 1));
+			auto const lo = std::max<std::size_t>(1, sh.min_segment), hi = std::max(lo, sh.max_segment);
+			std::size_t len{lo};
+			if (sh.lengths == length_dist::uniform) {
+				len += std::size_t(h % (hi - lo + 1));
+			} else {
+				for (auto bits = h; len < hi && (bits & 1); bits >>= 1) len++;
+			}
+			std::string s(len, 'a');
+			for (std::size_t i = 0; i < len; i++) {
+				if (i % 12 == 0) h = mix(h);
+				s[i] = char('a' + (h >> ((i % 12) * 5)) % 26);
+			}
+			return s;
+		}
+	} // namespace detail
+
+	/**
+	 * @brief sh.count distinct keys of the shape, in the order they
+	 * were made.
+	 * @details Fewer keys are returned if the shape cannot hold that
+	 * many, that is when the virtual tree is too small.
+	 * @code
+	 * trie::keygen::shape sh;
+	 * sh.count = 100000, sh.fanout = {4, 64, 64}, sh.shared_prefix = 0.8;
+	 * auto keys = trie::keygen::make_keys(sh);
+	 * @endcode
+	 */
+	inline auto make_keys(shape const &sh) -> std::vector<std::string> {
+		std::vector<std::string> keys;
+		std::unordered_set<std::string> seen;
+		keys.reserve(sh.count);
+		seen.reserve(sh.count);
+
+		std::mt19937_64 rng(sh.seed);
+		auto const min_depth = std::max<std::size_t>(1, sh.min_depth);
+		auto const max_depth = std::max(min_depth, sh.max_depth);
+		auto fanout_at = [&sh](std::size_t level) -> std::size_t {
+			if (sh.fanout.empty()) return 16;
+			return std::max<std::size_t>(1, sh.fanout[std::min(level, sh.fanout.size() - 1)]);
+		};
+		// a sampler of children per level
+		std::vector<zipf> pickers;
+		for (std::size_t level = 0; level < max_depth; level++) pickers.emplace_back(fanout_at(level), sh.segment_skew);
+
+		struct step {
+			std::uint64_t id; // the node reached
+			std::size_t end;  // the length of the key up to it
+		};
+		std::vector<step> path; // of the previous key
+		std::string key;
+		for (std::size_t misses = 0; keys.size() < sh.count && misses < sh.count * 4 + 1000;) {
+			auto const depth = min_depth + std::size_t(rng() % (max_depth - min_depth + 1));
+			std::size_t keep{0};
+			if (!path.empty() && unit(rng) < sh.shared_prefix)
+				keep = std::min<std::size_t>(std::size_t(rng() % path.size()) + 1, depth - 1);
+			path.resize(keep);
+			key.resize(keep ? path.back().end : 0);
+			for (auto level = keep; level < depth; level++) {
+				auto const parent = level ? path.back().id : detail::mix(sh.seed);
+				auto const index = pickers[level](rng);
+				if (level) key += sh.delimiter;
+				key += detail::segment(sh, parent, index);
+				path.push_back({detail::mix(parent + index + 1), key.size()});
+			}
+			if (seen.insert(key).second) {
+				keys.push_back(key);
+				misses = 0;
+			} else {
+				misses++;
+			}
+		}
+		return keys;
+	}
+
+	/**
+	 * @brief a query of a trace, and whether it is one of the keys.
+	 */
+	struct query {
+		std::string key;
+		bool hit{};
+	};
+
+	struct trace_options {
+		std::size_t count{100000};
+		double hit_ratio{0.9}; // the share of queries for existing keys
+		double skew{0.99};     // the Zipf skew of the access to keys, 0 is uniform
+		char delimiter{'.'};
+		std::uint64_t seed{1};
+	};
+
+	/**
+	 * @brief a query trace over keys: hits drawn with a Zipf-skewed
+	 * popularity, misses made from keys by changing their last segment,
+	 * so that they run deep into the trie before failing.
+	 * @details The popular keys are spread over the key set at random,
+	 * not the first ones made.
+	 */
+	inline auto make_trace(std::vector<std::string> const &keys, trace_options const &opt) -> std::vector<query> {
+		std::vector<query> trace;
+		if (keys.empty()) return trace;
+		trace.reserve(opt.count);
+
+		std::mt19937_64 rng(opt.seed);
+		std::vector<std::size_t> rank(keys.size());
+		for (std::size_t i = 0; i < rank.size(); i++) rank[i] = i;
+		shuffle(rank.begin(), rank.end(), rng);
+		zipf const popularity(keys.size(), opt.skew);
+		std::unordered_set<std::string_view> const present(keys.begin(), keys.end());
+
+		for (std::size_t i = 0; i < opt.count; i++) {
+			auto const &key = keys[rank[popularity(rng)]];
+			if (unit(rng) < opt.hit_ratio) {
+				trace.push_back({key, true});
+				continue;
+			}
+			auto miss = key;
+			auto const pos = miss.rfind(opt.delimiter);
+			auto const at = pos == std::string::npos ? 0 : pos + 1;
+			do {
+				miss.resize(at);
+				miss += char('a' + rng() % 26);
+				miss += std::to_string(rng() % 1000);
+			} while (present.contains(miss));
+			trace.push_back({std::move(miss), false});
+		}
+		return trace;
+	}
+} // namespace trie::keygen
+
+#endif // TRIE_CXX_TRIE_KEYGEN_HH
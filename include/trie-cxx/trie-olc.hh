@@ -0,0 +1,617 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_OLC_HH
+#define TRIE_CXX_TRIE_OLC_HH
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <thread>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "trie-node.hh"
+
+// version_lock
+namespace trie::olc {
+	/**
+	 * @brief version_lock is the per-node lock word of an optimistic
+	 * lock coupling (OLC) tree, as described by the ART-OLC paper.
+	 * @details The 64-bit word holds a version counter (bits 2..63),
+	 * a locked bit (bit 1) and an obsolete bit (bit 0).
+	 *
+	 * Readers never write to the word: they take a snapshot of the
+	 * version before reading a node and validate it afterwards, and
+	 * restart the whole operation if a writer got in between.
+	 * Writers upgrade a validated snapshot to an exclusive lock with
+	 * a single CAS, so a node that was changed since the snapshot
+	 * cannot be locked with a stale view.
+	 * @code{c++}
+	 * bool restart{};
+	 * auto v = nd.lock().read_lock_or_restart(restart);
+	 * if (restart) goto again;
+	 * // ... read the node ...
+	 * nd.lock().read_unlock_or_restart(v, restart);
+	 * if (restart) goto again;
+	 * @endcode
+	 */
+	class version_lock {
+	public:
+		using version_t = std::uint64_t;
+
+		version_lock() = default;
+		~version_lock() = default;
+		version_lock(version_lock const &) = delete;
+		version_lock &operator=(version_lock const &) = delete;
+
+		static constexpr bool is_locked(version_t v) { return (v & 0b10) == 0b10; }
+		static constexpr bool is_obsolete(version_t v) { return (v & 0b01) == 0b01; }
+
+		auto read_lock_or_restart(bool &need_restart) const -> version_t {
+			version_t v = await_node_unlocked();
+			if (is_obsolete(v)) need_restart = true;
+			return v;
+		}
+		void check_or_restart(version_t start_read, bool &need_restart) const {
+			read_unlock_or_restart(start_read, need_restart);
+		}
+		void read_unlock_or_restart(version_t start_read, bool &need_restart) const {
+			if (start_read != _word.load(std::memory_order_acquire)) need_restart = true;
+		}
+
+		void upgrade_to_write_lock_or_restart(version_t &v, bool &need_restart) {
+			if (_word.compare_exchange_strong(v, v + 0b10, std::memory_order_acquire)) {
+				v = v + 0b10;
+			} else {
+				need_restart = true;
+			}
+		}
+		void write_lock_or_restart(bool &need_restart) {
+			version_t v = read_lock_or_restart(need_restart);
+			if (need_restart) return;
+			upgrade_to_write_lock_or_restart(v, need_restart);
+		}
+		void write_unlock() { _word.fetch_add(0b10, std::memory_order_release); }
+		void write_unlock_obsolete() { _word.fetch_add(0b11, std::memory_order_release); }
+
+		auto version() const -> version_t { return _word.load(std::memory_order_acquire); }
+
+	private:
+		auto await_node_unlocked() const -> version_t {
+			version_t v = _word.load(std::memory_order_acquire);
+			for (unsigned spins{0}; is_locked(v); v = _word.load(std::memory_order_acquire)) {
+				if (++spins > 64) {
+					std::this_thread::yield();
+					spins = 0;
+				}
+			}
+			return v;
+		}
+
+	private:
+		std::atomic<version_t> _word{0b100};
+	};
+} // namespace trie::olc
+
+// olc_node
+namespace trie {
+	/**
+	 * @brief olc_node is the node type of olc_trie_t.
+	 * @details The fragment of an olc_node never changes after the
+	 * node was built. The children list and the value are immutable
+	 * snapshots published through atomic shared pointers, so a reader
+	 * always sees either the old or the new snapshot, and a snapshot
+	 * stays alive for as long as a reader holds it. A split never
+	 * modifies the split node, it builds the replacement nodes and
+	 * marks the old one obsolete.
+	 */
+	template<typename ValueT>
+	class olc_node final {
+	public:
+		using node_t = olc_node<ValueT>;
+		using value_t = ValueT;
+		using node_ptr = std::shared_ptr<node_t>;
+		using value_ptr = std::shared_ptr<value_t const>;
+		using children_t = std::vector<node_ptr>;
+		using children_ptr = std::shared_ptr<children_t const>;
+
+		olc_node() = default;
+		~olc_node() = default;
+		explicit olc_node(std::string_view frag, children_ptr children, value_ptr value)
+		    : _fragment(frag)
+		    , _children(std::move(children))
+		    , _value(std::move(value)) {
+		}
+
+	public:
+		std::string const &fragment() const { return _fragment; }
+		auto children() const -> children_ptr { return _children.load(std::memory_order_acquire); }
+		void children(children_ptr c) { _children.store(std::move(c), std::memory_order_release); }
+		auto value() const -> value_ptr { return _value.load(std::memory_order_acquire); }
+		auto value(value_ptr v) -> value_ptr { return _value.exchange(std::move(v), std::memory_order_acq_rel); }
+		bool is_leaf() const { return bool(value()); }
+
+		olc::version_lock &lock() const { return _lock; }
+
+		/**
+		 * @brief find the child whose fragment starts with @p ch.
+		 * @details children are kept in byte order of their leading
+		 * char, the siblings of a radix tree never share it.
+		 */
+		static auto child_of(children_t const &children, char ch) -> node_t * {
+			auto it = std::lower_bound(children.begin(), children.end(), ch, [](node_ptr const &a, char c) {
+				return static_cast<unsigned char>(a->_fragment.front()) < static_cast<unsigned char>(c);
+			});
+			if (it != children.end() && (*it)->_fragment.front() == ch)
+				return it->get();
+			return nullptr;
+		}
+
+		/**
+		 * @brief build a new children snapshot with @p ch inserted
+		 * in order, or replacing the sibling which has the same
+		 * leading char.
+		 */
+		static auto with_child(children_t const *children, node_ptr ch) -> children_ptr {
+			auto ret = std::make_shared<children_t>();
+			if (children) ret->reserve(children->size() + 1);
+			bool placed{false};
+			auto const key = static_cast<unsigned char>(ch->_fragment.front());
+			if (children) {
+				for (auto const &it : *children) {
+					auto const c = static_cast<unsigned char>(it->_fragment.front());
+					if (!placed && c >= key) {
+						ret->push_back(ch);
+						placed = true;
+						if (c == key) continue;
+					}
+					ret->push_back(it);
+				}
+			}
+			if (!placed) ret->push_back(std::move(ch));
+			return ret;
+		}
+
+		static auto without_child(children_t const &children, node_t const *ch) -> children_ptr {
+			auto ret = std::make_shared<children_t>();
+			ret->reserve(children.size());
+			for (auto const &it : children)
+				if (it.get() != ch) ret->push_back(it);
+			return ret;
+		}
+
+	private:
+		mutable olc::version_lock _lock{};
+		std::string const _fragment{};
+		std::atomic<children_ptr> _children{};
+		std::atomic<value_ptr> _value{}; // empty for a branch node
+	};
+} // namespace trie
+
+// olc_trie_t
+namespace trie {
+	/**
+	 * @brief A radix-trie tree which allows concurrent writers, with
+	 * optimistic lock coupling (OLC).
+	 * @details Each node carries a version_lock. A lookup descends
+	 * the tree without taking any lock, validates every version it
+	 * read and restarts from the root when a concurrent writer has
+	 * changed a node on its path. A writer descends in the same way
+	 * and then write-locks only the nodes it really modifies:
+	 *
+	 * - adding a new child or replacing a value locks one node;
+	 * - splitting a node locks the node and its parent;
+	 * - removing a key locks the path from the grandparent of its
+	 *   node down to the sibling which is merged into the parent.
+	 *
+	 * So writers to disjoint key ranges, such as `app.server.*` and
+	 * `app.logging.*`, proceed in parallel once the common prefix
+	 * `app.` has been built.
+	 *
+	 * olc_trie_t keeps the trie_t key semantics but stores values as
+	 * immutable snapshots: find() returns a shared pointer to the
+	 * value which stays valid even if the key is updated or removed
+	 * concurrently.
+	 * @code{c++}
+	 * trie::olc_trie_t<trie::value_t> tt;
+	 * std::thread t1([&tt] { tt.insert("app.server.port", 8080); });
+	 * std::thread t2([&tt] { tt.insert("app.logging.file", "~/.trie.log"); });
+	 * t1.join(), t2.join();
+	 * if (auto v = tt.find("app.server.port")) std::cout << *v << '\n';
+	 * @endcode
+	 */
+	template<typename ValueT>
+	class olc_trie_t {
+	public:
+		using node_t = olc_node<ValueT>;
+		using value_t = typename node_t::value_t;
+		using node_ptr = typename node_t::node_ptr;
+		using value_ptr = typename node_t::value_ptr;
+		using children_t = typename node_t::children_t;
+		using children_ptr = typename node_t::children_ptr;
+		using walk_cb = std::function<void(std::string const &key, value_t const &value)>;
+
+		olc_trie_t()
+		    : _root(std::make_shared<node_t>()) {
+		}
+		~olc_trie_t() = default;
+		olc_trie_t(olc_trie_t const &) = delete;
+		olc_trie_t &operator=(olc_trie_t const &) = delete;
+
+	public:
+		/**
+		 * @brief insert or update a key.
+		 * @return the old value if the key existed, or an empty pointer.
+		 */
+		template<typename... Args, std::enable_if_t<std::is_constructible_v<value_t, Args...>, bool> = true>
+		auto insert(std::string_view key, Args &&...args) -> value_ptr {
+			if (key.empty()) return {};
+			return insert_internal(key, std::make_shared<value_t const>(std::forward<Args>(args)...));
+		}
+		auto set(std::string_view key, value_t &&value) -> value_ptr { return insert(key, std::move(value)); }
+
+		/**
+		 * @brief remove a key.
+		 * @details remove() keeps the tree compact, like trie_t::remove()
+		 * does with compact():
+		 * - a node with two or more children is turned to a branch node;
+		 * - a node with one child is merged with the child;
+		 * - a node without children is unlinked from its parent. If the
+		 *   parent is a branch node which is left with one child, it is
+		 *   merged with that child, or unlinked if it is left empty.
+		 *
+		 * The replaced nodes are marked obsolete, so that concurrent
+		 * readers and writers which reached them restart.
+		 * @return the removed value, or an empty pointer if the key
+		 * did not exist.
+		 */
+		auto remove(std::string_view key) -> value_ptr;
+
+		/**
+		 * @brief lookup a key without taking any lock.
+		 * @return the value snapshot, or an empty pointer if not found.
+		 */
+		auto find(std::string_view key) const -> value_ptr;
+		auto has(std::string_view key) const -> bool { return bool(find(key)); }
+		auto get(std::string_view key, value_t const &default_val) const -> value_t {
+			if (auto v = find(key)) return *v;
+			return default_val;
+		}
+
+		/**
+		 * @brief walk all leaves in byte order.
+		 * @details walk() reads children snapshots only. It is safe to
+		 * run it with concurrent writers, and it reports a consistent
+		 * view of each node it visits, but not an atomic snapshot of
+		 * the whole tree.
+		 */
+		auto walk(walk_cb const &cb) const -> void;
+
+		/**
+		 * @brief calculating the count of leaves recursively.
+		 */
+		auto size() const -> std::size_t;
+
+		auto root() const -> node_t const & { return *_root; }
+
+	private:
+		using version_t = olc::version_lock::version_t;
+
+		auto insert_internal(std::string_view key, value_ptr value) -> value_ptr;
+
+		// upgrade the read snapshots of nodes, from the top down, to
+		// write locks: all of them or none.
+		static auto write_lock_all(std::initializer_list<std::pair<node_t *, version_t>> nodes) -> bool {
+			std::size_t locked{0};
+			for (auto [nd, v] : nodes) {
+				bool need_restart{false};
+				nd->lock().upgrade_to_write_lock_or_restart(v, need_restart);
+				if (need_restart) {
+					for (auto it = nodes.begin(); locked > 0; ++it, --locked)
+						it->first->lock().write_unlock();
+					return false;
+				}
+				++locked;
+			}
+			return true;
+		}
+		// the node replacing nd and its only child
+		static auto merged(node_t const &nd, node_t const &only) -> node_ptr {
+			return std::make_shared<node_t>(nd.fragment() + only.fragment(), only.children(), only.value());
+		}
+		auto walk_r(node_t const &nd, std::string &key, walk_cb const &cb) const -> void;
+
+	private:
+		node_ptr _root;
+	}; // class olc_trie_t<...>
+} // namespace trie
+
+// olc_trie_t<...>
+namespace trie {
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::
+	        insert_internal(std::string_view key, value_ptr value) -> value_ptr {
+	restart:
+		bool need_restart{false};
+		node_t *nd = _root.get();
+		children_ptr holder{}; // the snapshot which keeps nd alive
+		auto v = nd->lock().read_lock_or_restart(need_restart);
+		if (need_restart) goto restart;
+
+		for (std::size_t pos{0};;) {
+			// nd's fragment is matched completely, and key[pos..] is left.
+			if (pos == key.size()) {
+				// a successful upgrade proves nd is still linked: an
+				// obsolete node has a newer version than v.
+				nd->lock().upgrade_to_write_lock_or_restart(v, need_restart);
+				if (need_restart) goto restart;
+				auto old = nd->value(std::move(value));
+				nd->lock().write_unlock();
+				return old;
+			}
+
+			auto children = nd->children();
+			node_t *ch = children ? node_t::child_of(*children, key[pos]) : nullptr;
+			if (!ch) {
+				// add a new leaf under nd
+				nd->lock().upgrade_to_write_lock_or_restart(v, need_restart);
+				if (need_restart) goto restart;
+				auto leaf = std::make_shared<node_t>(key.substr(pos), children_ptr{}, std::move(value));
+				nd->children(node_t::with_child(children.get(), std::move(leaf)));
+				nd->lock().write_unlock();
+				return {};
+			}
+
+			auto ch_v = ch->lock().read_lock_or_restart(need_restart);
+			if (need_restart) goto restart;
+			nd->lock().read_unlock_or_restart(v, need_restart);
+			if (need_restart) goto restart;
+
+			auto const &frag = ch->fragment();
+			auto const rest = key.substr(pos);
+			std::size_t cp{0};
+			for (auto const n = std::min(frag.size(), rest.size()); cp < n && frag[cp] == rest[cp];)
+				++cp;
+
+			if (cp == frag.size()) {
+				holder = std::move(children);
+				nd = ch;
+				v = ch_v;
+				pos += cp;
+				continue;
+			}
+
+			// split ch at cp: lock ch and its parent nd, and replace ch
+			// with a new branch node holding the both halves.
+			nd->lock().upgrade_to_write_lock_or_restart(v, need_restart);
+			if (need_restart) goto restart;
+			ch->lock().upgrade_to_write_lock_or_restart(ch_v, need_restart);
+			if (need_restart) {
+				nd->lock().write_unlock();
+				goto restart;
+			}
+
+			auto tail = std::make_shared<node_t>(std::string_view{frag}.substr(cp), ch->children(), ch->value());
+			node_ptr mid;
+			if (cp == rest.size()) {
+				// key ends inside ch's fragment
+				mid = std::make_shared<node_t>(rest, node_t::with_child(nullptr, std::move(tail)), std::move(value));
+			} else {
+				auto leaf = std::make_shared<node_t>(rest.substr(cp), children_ptr{}, std::move(value));
+				auto mid_children = node_t::with_child(nullptr, std::move(tail));
+				mid_children = node_t::with_child(mid_children.get(), std::move(leaf));
+				mid = std::make_shared<node_t>(rest.substr(0, cp), std::move(mid_children), value_ptr{});
+			}
+			nd->children(node_t::with_child(children.get(), std::move(mid)));
+			ch->lock().write_unlock_obsolete();
+			nd->lock().write_unlock();
+			return {};
+		}
+	}
+
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::
+	        remove(std::string_view key) -> value_ptr {
+		if (key.empty()) return {};
+	restart:
+		bool need_restart{false};
+		node_t *grand{nullptr}, *parent{nullptr};
+		version_t grand_v{}, parent_v{};
+		node_t *nd = _root.get();
+		children_ptr holder{}, parent_holder{}, grand_holder{};
+		auto v = nd->lock().read_lock_or_restart(need_restart);
+		if (need_restart) goto restart;
+
+		for (std::size_t pos{0};;) {
+			if (pos == key.size()) {
+				if (!nd->is_leaf()) {
+					nd->lock().read_unlock_or_restart(v, need_restart);
+					if (need_restart) goto restart;
+					return {};
+				}
+
+				auto const children = nd->children();
+				auto const count = children ? children->size() : 0;
+				if (count > 1) {
+					// keep the node as a branch
+					nd->lock().upgrade_to_write_lock_or_restart(v, need_restart);
+					if (need_restart) goto restart;
+					auto old = nd->value(value_ptr{});
+					nd->lock().write_unlock();
+					return old;
+				}
+
+				if (count == 1) {
+					// merge nd with its only child
+					auto *only = children->front().get();
+					auto only_v = only->lock().read_lock_or_restart(need_restart);
+					if (need_restart) goto restart;
+					if (!write_lock_all({{parent, parent_v}, {nd, v}, {only, only_v}})) goto restart;
+					auto old = nd->value();
+					parent->children(node_t::with_child(parent->children().get(), merged(*nd, *only)));
+					only->lock().write_unlock_obsolete();
+					nd->lock().write_unlock_obsolete();
+					parent->lock().write_unlock();
+					return old;
+				}
+
+				// unlink nd. a branch parent left with one child is
+				// merged with it, and one left empty is unlinked too.
+				auto const siblings = parent->children();
+				if (!grand || parent->is_leaf() || siblings->size() > 2) {
+					if (!write_lock_all({{parent, parent_v}, {nd, v}})) goto restart;
+					auto old = nd->value();
+					parent->children(node_t::without_child(*siblings, nd));
+					nd->lock().write_unlock_obsolete();
+					parent->lock().write_unlock();
+					return old;
+				}
+
+				if (siblings->size() == 1) {
+					if (!write_lock_all({{grand, grand_v}, {parent, parent_v}, {nd, v}})) goto restart;
+					auto old = nd->value();
+					grand->children(node_t::without_child(*grand->children(), parent));
+					nd->lock().write_unlock_obsolete();
+					parent->lock().write_unlock_obsolete();
+					grand->lock().write_unlock();
+					return old;
+				}
+
+				auto *sibling = (*siblings)[siblings->front().get() == nd ? 1 : 0].get();
+				auto sibling_v = sibling->lock().read_lock_or_restart(need_restart);
+				if (need_restart) goto restart;
+				if (!write_lock_all({{grand, grand_v}, {parent, parent_v}, {nd, v}, {sibling, sibling_v}})) goto restart;
+				auto old = nd->value();
+				grand->children(node_t::with_child(grand->children().get(), merged(*parent, *sibling)));
+				sibling->lock().write_unlock_obsolete();
+				nd->lock().write_unlock_obsolete();
+				parent->lock().write_unlock_obsolete();
+				grand->lock().write_unlock();
+				return old;
+			}
+
+			auto children = nd->children();
+			node_t *ch = children ? node_t::child_of(*children, key[pos]) : nullptr;
+			if (!ch) {
+				nd->lock().read_unlock_or_restart(v, need_restart);
+				if (need_restart) goto restart;
+				return {};
+			}
+
+			auto ch_v = ch->lock().read_lock_or_restart(need_restart);
+			if (need_restart) goto restart;
+			nd->lock().read_unlock_or_restart(v, need_restart);
+			if (need_restart) goto restart;
+
+			auto const &frag = ch->fragment();
+			if (key.substr(pos, frag.size()) != frag) {
+				ch->lock().read_unlock_or_restart(ch_v, need_restart);
+				if (need_restart) goto restart;
+				return {};
+			}
+
+			grand_holder = std::move(parent_holder);
+			parent_holder = std::move(holder);
+			holder = std::move(children);
+			grand = parent;
+			grand_v = parent_v;
+			parent = nd;
+			parent_v = v;
+			nd = ch;
+			v = ch_v;
+			pos += frag.size();
+		}
+	}
+
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::
+	        find(std::string_view key) const -> value_ptr {
+		if (key.empty()) return {};
+	restart:
+		bool need_restart{false};
+		node_t const *nd = _root.get();
+		children_ptr holder{}; // the snapshot which keeps nd alive
+		auto v = nd->lock().read_lock_or_restart(need_restart);
+		if (need_restart) goto restart;
+
+		for (std::size_t pos{0};;) {
+			if (pos == key.size()) {
+				auto val = nd->value();
+				nd->lock().read_unlock_or_restart(v, need_restart);
+				if (need_restart) goto restart;
+				return val;
+			}
+
+			auto children = nd->children();
+			node_t const *ch = children ? node_t::child_of(*children, key[pos]) : nullptr;
+			if (!ch) {
+				nd->lock().read_unlock_or_restart(v, need_restart);
+				if (need_restart) goto restart;
+				return {};
+			}
+
+			auto ch_v = ch->lock().read_lock_or_restart(need_restart);
+			if (need_restart) goto restart;
+			nd->lock().read_unlock_or_restart(v, need_restart);
+			if (need_restart) goto restart;
+
+			auto const &frag = ch->fragment();
+			if (key.substr(pos, frag.size()) != frag) {
+				ch->lock().read_unlock_or_restart(ch_v, need_restart);
+				if (need_restart) goto restart;
+				return {};
+			}
+
+			holder = std::move(children);
+			nd = ch;
+			v = ch_v;
+			pos += frag.size();
+		}
+	}
+
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::
+	        walk(walk_cb const &cb) const -> void {
+		std::string key;
+		walk_r(*_root, key, cb);
+	}
+
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::
+	        walk_r(node_t const &nd, std::string &key, walk_cb const &cb) const -> void {
+		auto const len = key.size();
+		key += nd.fragment();
+		if (auto val = nd.value()) cb(key, *val);
+		if (auto children = nd.children()) {
+			for (auto const &ch : *children)
+				walk_r(*ch, key, cb);
+		}
+		key.resize(len);
+	}
+
+	template<typename ValueT>
+	inline auto olc_trie_t<ValueT>::size() const -> std::size_t {
+		std::size_t count{0};
+		walk([&count](std::string const &, value_t const &) { count++; });
+		return count;
+	}
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_OLC_HH
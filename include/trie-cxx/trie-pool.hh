@@ -0,0 +1,406 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_POOL_HH
+#define TRIE_CXX_TRIE_POOL_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+
+// executor concepts
+namespace trie::pool {
+	using task_t = std::function<void()>;
+
+	/**
+	 * @brief executor is anything which accepts a void() task by
+	 * `submit()` and runs it sometime later, on any thread.
+	 */
+	template<typename E>
+	concept executor = requires(E &e, task_t task) {
+		e.submit(std::move(task));
+	};
+
+	/**
+	 * @brief helping_executor can also run one of its pending tasks
+	 * on the calling thread. A thread which waits for a task_group
+	 * uses it to help instead of blocking, so that waiting inside a
+	 * pool worker never starves the pool.
+	 */
+	template<typename E>
+	concept helping_executor = executor<E> && requires(E &e) {
+		{ e.try_run_one() } -> std::convertible_to<bool>;
+	};
+} // namespace trie::pool
+
+// build options
+//
+// TRIE_ENABLE_THREAD_POOL_READY_SIGNAL: thread_pool's constructor
+// returns after all of its workers are running.
+// TRIE_TEST_THREAD_POOL_DBGOUT: enable `pool_debug(fmt, ...)` tracing
+// to stderr.
+#ifndef TRIE_ENABLE_THREAD_POOL_READY_SIGNAL
+#define TRIE_ENABLE_THREAD_POOL_READY_SIGNAL 0
+#endif
+
+#ifndef TRIE_TEST_THREAD_POOL_DBGOUT
+#define TRIE_TEST_THREAD_POOL_DBGOUT 0
+#endif
+
+#ifndef pool_debug
+#if TRIE_TEST_THREAD_POOL_DBGOUT
+#define pool_debug(...)                               \
+	do {                                              \
+		std::fprintf(stderr, "[trie::pool] ");        \
+		std::fprintf(stderr, __VA_ARGS__);            \
+		std::fprintf(stderr, "\n");                   \
+	} while (0)
+#else
+#define pool_debug(...) (void) 0
+#endif
+#endif
+
+// thread_pool
+namespace trie::pool {
+	/**
+	 * @brief the default count of workers: the environment variable
+	 * TRIE_POOL_THREADS if set, or the count of hardware threads.
+	 */
+	inline auto default_concurrency() -> std::size_t {
+		if (auto const *env = std::getenv("TRIE_POOL_THREADS")) {
+			if (auto n = std::strtol(env, nullptr, 10); n > 0)
+				return std::size_t(n);
+		}
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	namespace detail {
+		// identifies the pool and the deque of a worker thread
+		struct worker_slot {
+			void const *pool{};
+			std::size_t index{};
+		};
+		inline thread_local worker_slot current_worker{};
+	} // namespace detail
+
+	/**
+	 * @brief thread_pool is a work-stealing pool of worker threads.
+	 * @details Each worker owns a deque. A task submitted from a
+	 * worker goes to the back of its own deque and is popped from
+	 * there in LIFO order, which keeps a forked subtree hot in the
+	 * cache of the thread that forked it. A task submitted from any
+	 * other thread goes to a shared injection queue. An idle worker
+	 * steals the oldest task, from the front of another deque, and
+	 * parks on a condition variable once there is nothing to steal.
+	 * @code{c++}
+	 * trie::pool::thread_pool pool(8);
+	 * tt.parallel_walk(cb, pool);
+	 * @endcode
+	 */
+	class thread_pool {
+	public:
+		explicit thread_pool(std::size_t threads = default_concurrency()) {
+			threads = std::max<std::size_t>(1, threads);
+			_queues.reserve(threads);
+			for (std::size_t i = 0; i < threads; i++)
+				_queues.push_back(std::make_unique<work_queue>());
+			_workers.reserve(threads);
+			for (std::size_t i = 0; i < threads; i++)
+				_workers.emplace_back([this, i] { run(i); });
+#if TRIE_ENABLE_THREAD_POOL_READY_SIGNAL
+			std::unique_lock lock(_park_mu);
+			_ready_cv.wait(lock, [this] { return _ready == _queues.size(); });
+#endif
+			pool_debug("%zu workers started", threads);
+		}
+		~thread_pool() {
+			{
+				std::lock_guard lock(_park_mu);
+				_stopping = true;
+			}
+			_park_cv.notify_all();
+			for (auto &w : _workers) w.join();
+			pool_debug("%zu workers stopped", _workers.size());
+		}
+		thread_pool(thread_pool const &) = delete;
+		thread_pool &operator=(thread_pool const &) = delete;
+
+		auto size() const -> std::size_t { return _workers.size(); }
+		auto parked() const -> std::size_t { return _sleeping.load(); }
+
+		auto submit(task_t task) -> void {
+			auto &q = is_worker() ? *_queues[detail::current_worker.index] : _injected;
+			{
+				std::lock_guard lock(q.mu);
+				q.tasks.push_back(std::move(task));
+			}
+			_queued.fetch_add(1);
+			if (_sleeping.load() > 0) {
+				// pairs with the predicate check in run(), so that a
+				// worker going to park cannot miss this task.
+				{ std::lock_guard lock(_park_mu); }
+				_park_cv.notify_one();
+			}
+		}
+
+		auto try_run_one() -> bool {
+			task_t task;
+			if (!find_task(is_worker() ? detail::current_worker.index : npos, task))
+				return false;
+			task();
+			return true;
+		}
+
+	private:
+		static constexpr std::size_t npos = std::size_t(-1);
+		static constexpr int spins_before_park = 64;
+
+		struct work_queue {
+			std::mutex mu{};
+			std::deque<task_t> tasks{};
+		};
+
+		auto is_worker() const -> bool { return detail::current_worker.pool == this; }
+
+		auto take(work_queue &q, bool from_back, task_t &task) -> bool {
+			std::lock_guard lock(q.mu);
+			if (q.tasks.empty()) return false;
+			if (from_back) {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			} else {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			_queued.fetch_sub(1);
+			return true;
+		}
+
+		auto find_task(std::size_t self, task_t &task) -> bool {
+			if (self != npos && take(*_queues[self], true, task)) return true;
+			if (take(_injected, false, task)) return true;
+			auto const n = _queues.size();
+			for (std::size_t k = 1; k <= n; k++) {
+				auto const victim = self == npos ? k - 1 : (self + k) % n;
+				if (victim == self) continue;
+				if (take(*_queues[victim], false, task)) {
+					pool_debug("worker #%zu stole a task from #%zu", self, victim);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		auto run(std::size_t index) -> void {
+			detail::current_worker = {this, index};
+#if TRIE_ENABLE_THREAD_POOL_READY_SIGNAL
+			{
+				std::lock_guard lock(_park_mu);
+				if (++_ready == _queues.size()) _ready_cv.notify_one();
+			}
+#endif
+			for (int idle = 0;;) {
+				task_t task;
+				if (find_task(index, task)) {
+					idle = 0;
+					task();
+					continue;
+				}
+				if (++idle < spins_before_park) {
+					std::this_thread::yield();
+					continue;
+				}
+
+				std::unique_lock lock(_park_mu);
+				_sleeping.fetch_add(1);
+				_park_cv.wait(lock, [this] { return _stopping || _queued.load() > 0; });
+				_sleeping.fetch_sub(1);
+				if (_stopping && _queued.load() == 0) break;
+				idle = 0;
+			}
+			detail::current_worker = {};
+		}
+
+	private:
+		std::vector<std::unique_ptr<work_queue>> _queues{};
+		work_queue _injected{};
+		std::vector<std::thread> _workers{};
+		std::atomic<std::size_t> _queued{0};
+		std::atomic<std::size_t> _sleeping{0};
+		std::mutex _park_mu{};
+		std::condition_variable _park_cv{};
+		bool _stopping{};
+#if TRIE_ENABLE_THREAD_POOL_READY_SIGNAL
+		std::size_t _ready{};
+		std::condition_variable _ready_cv{};
+#endif
+	}; // class thread_pool
+} // namespace trie::pool
+
+// task_group
+namespace trie::pool {
+	/**
+	 * @brief task_group tracks a set of tasks forked onto an
+	 * executor, so that wait() returns after all of them (and the
+	 * tasks they forked into the same group) are done. The first
+	 * exception thrown by a task is rethrown from wait(), once all
+	 * the tasks are done.
+	 * @code{c++}
+	 * trie::pool::thread_pool pool;
+	 * trie::pool::task_group tg;
+	 * for (auto &part : parts)
+	 *   tg.run(pool, [&part] { process(part); });
+	 * tg.wait(pool);
+	 * @endcode
+	 */
+	class task_group {
+	public:
+		task_group() = default;
+		~task_group() = default;
+		task_group(task_group const &) = delete;
+		task_group &operator=(task_group const &) = delete;
+
+		template<executor Executor, typename F>
+		auto run(Executor &ex, F &&fn) -> void {
+			_pending.fetch_add(1, std::memory_order_relaxed);
+			ex.submit([this, fn = std::forward<F>(fn)]() mutable {
+				// count the task done even if it throws
+				struct done_t {
+					task_group *tg;
+					~done_t() {
+						std::lock_guard lock(tg->_mu);
+						if (tg->_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+							tg->_cv.notify_all();
+					}
+				} done{this};
+				try {
+					fn();
+				} catch (...) {
+					std::lock_guard lock(_mu);
+					if (!_error) _error = std::current_exception();
+				}
+			});
+		}
+
+		template<executor Executor>
+		auto wait(Executor &ex) -> void {
+			while (_pending.load(std::memory_order_acquire) > 0) {
+				if constexpr (helping_executor<Executor>) {
+					if (ex.try_run_one()) continue;
+				}
+				std::unique_lock lock(_mu);
+				_cv.wait_for(lock, std::chrono::milliseconds(1),
+				             [this] { return _pending.load(std::memory_order_acquire) == 0; });
+			}
+			// the last task may still be holding _mu to notify us, the
+			// group must outlive it.
+			std::unique_lock lock(_mu);
+			if (auto error = std::exchange(_error, nullptr)) {
+				lock.unlock();
+				std::rethrow_exception(error);
+			}
+		}
+
+	private:
+		std::atomic<std::size_t> _pending{0};
+		std::mutex _mu{};
+		std::condition_variable _cv{};
+		std::exception_ptr _error{}; // the first one thrown by a task
+	}; // class task_group
+} // namespace trie::pool
+
+// executor_ref, default_pool, default_executor
+namespace trie::pool {
+	/**
+	 * @brief executor_ref is a non-owning, type-erased reference to
+	 * any executor, so that an external executor (an asio io_context
+	 * wrapper, a tbb task_arena adapter, ...) can be plugged in at
+	 * runtime with use_executor().
+	 */
+	class executor_ref {
+	public:
+		template<executor E>
+		    requires(!std::is_same_v<std::remove_cv_t<E>, executor_ref>)
+		executor_ref(E &ex) // NOLINT(google-explicit-constructor)
+		    : _ex(&ex)
+		    , _submit([](void *p, task_t task) { static_cast<E *>(p)->submit(std::move(task)); })
+		    , _try_run_one([](void *p) -> bool {
+			    if constexpr (helping_executor<E>) {
+				    return static_cast<E *>(p)->try_run_one();
+			    } else {
+				    (void) p;
+				    return false;
+			    }
+		    }) {}
+
+		auto submit(task_t task) -> void { _submit(_ex, std::move(task)); }
+		auto try_run_one() -> bool { return _try_run_one(_ex); }
+
+	private:
+		void *_ex;
+		void (*_submit)(void *, task_t);
+		bool (*_try_run_one)(void *);
+	};
+
+	/**
+	 * @brief the process-wide thread_pool, started on first use with
+	 * default_concurrency() workers.
+	 */
+	inline auto default_pool() -> thread_pool & {
+		static thread_pool pool;
+		return pool;
+	}
+
+	namespace detail {
+		inline auto custom_executor() -> std::optional<executor_ref> & {
+			static std::optional<executor_ref> ex{};
+			return ex;
+		}
+	} // namespace detail
+
+	/**
+	 * @brief plug an external executor in for the parallel apis
+	 * which are called without an explicit executor. It shall be
+	 * called at startup, before any of those apis runs, and ex must
+	 * outlive them.
+	 */
+	template<executor E>
+	inline auto use_executor(E &ex) -> void { detail::custom_executor().emplace(ex); }
+	inline auto use_default_executor() -> void { detail::custom_executor().reset(); }
+
+	/**
+	 * @brief the executor for the parallel apis called without an
+	 * explicit one: the one given to use_executor(), or default_pool().
+	 */
+	inline auto default_executor() -> executor_ref {
+		if (auto &ex = detail::custom_executor()) return *ex;
+		return default_pool();
+	}
+} // namespace trie::pool
+
+#endif // TRIE_CXX_TRIE_POOL_HH
@@ -0,0 +1,165 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_PREFILTER_HH
+#define TRIE_CXX_TRIE_PREFILTER_HH
+
+#include <bit>
+#include <string_view>
+
+#include <cstddef>
+#include <cstdint>
+
+// On x86 with gcc or clang, the AVX2 kernel is compiled for the avx2
+// target and chosen at runtime, so the library needs no -mavx2. Other
+// compilers use it when the whole program targets AVX2. Define
+// TRIE_DISABLE_SIMD to use the portable scalar loop only.
+#if !defined(TRIE_DISABLE_SIMD)
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TRIE_PREFILTER_AVX2 1
+#define TRIE_PREFILTER_AVX2_TARGET __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#define TRIE_PREFILTER_AVX2 1
+#define TRIE_PREFILTER_AVX2_TARGET
+#endif
+#endif
+
+#if defined(TRIE_PREFILTER_AVX2)
+#include <immintrin.h>
+#endif
+
+// literal_prefilter
+namespace trie {
+	/**
+	 * @brief literal_prefilter finds the offsets in a text where a key
+	 * may begin, by the first two bytes of the keys.
+	 * @details The exact test is a 64K-bit bitmap of the leading byte
+	 * pairs. Before it, a Teddy-style filter tests 32 offsets at a time
+	 * with AVX2: the keys are put into 8 buckets by the low 3 bits of
+	 * their first bytes, and for each of the two bytes a pair of
+	 * nibble tables (pshufb lookups) gives the buckets it may belong
+	 * to. An offset is a candidate if some bucket accepts all four
+	 * nibbles; the candidates are then checked against the bitmap.
+	 *
+	 * A 1-byte key accepts any second byte. The last byte of a text
+	 * is a candidate if it is the first byte of any key, since the
+	 * text may be a chunk of a stream which continues.
+	 */
+	class literal_prefilter {
+	public:
+		// add the leading bytes of a key
+		auto add(std::string_view key) -> void {
+			if (key.empty()) return;
+			auto const x = static_cast<unsigned char>(key[0]);
+			auto const bucket = static_cast<std::uint8_t>(1u << (x & 7));
+			_first[x >> 6] |= std::uint64_t(1) << (x & 63);
+			_masks[0][x & 15] |= bucket;
+			_masks[1][x >> 4] |= bucket;
+			if (key.size() == 1) {
+				for (unsigned y = 0; y < 256; y++) set_pair(x, y);
+				for (unsigned n = 0; n < 16; n++) {
+					_masks[2][n] |= bucket;
+					_masks[3][n] |= bucket;
+				}
+				return;
+			}
+			auto const y = static_cast<unsigned char>(key[1]);
+			set_pair(x, y);
+			_masks[2][y & 15] |= bucket;
+			_masks[3][y >> 4] |= bucket;
+		}
+
+		/**
+		 * @brief the first candidate offset in text at or after from.
+		 * @return text.size() if there is none
+		 */
+		auto find(std::string_view text, std::size_t from) const -> std::size_t {
+			auto const *p = reinterpret_cast<unsigned char const *>(text.data());
+			auto const n = text.size();
+			auto i = from;
+#if defined(TRIE_PREFILTER_AVX2)
+			if (simd()) i = find_avx2(p, n, i);
+#endif
+			for (; i + 1 < n; i++) {
+				if (pair(p[i], p[i + 1])) return i;
+			}
+			if (i + 1 == n && first(p[i])) return i;
+			return n;
+		}
+
+		auto empty() const -> bool { return _pair_count == 0; }
+		// the fraction of the byte pairs being candidates
+		auto density() const -> double { return double(_pair_count) / 65536.0; }
+		// whether find() runs the AVX2 kernel on this cpu
+		static auto simd() -> bool {
+#if defined(TRIE_PREFILTER_AVX2) && defined(__GNUC__)
+			static bool const avx2 = __builtin_cpu_supports("avx2");
+			return avx2;
+#elif defined(TRIE_PREFILTER_AVX2)
+			return true;
+#else
+			return false;
+#endif
+		}
+
+	private:
+		auto set_pair(unsigned x, unsigned y) -> void {
+			auto const k = (x << 8) | y;
+			auto &word = _pairs[k >> 6];
+			auto const bit = std::uint64_t(1) << (k & 63);
+			if (!(word & bit)) _pair_count++;
+			word |= bit;
+		}
+		auto pair(unsigned x, unsigned y) const -> bool {
+			auto const k = (x << 8) | y;
+			return (_pairs[k >> 6] >> (k & 63)) & 1;
+		}
+		auto first(unsigned x) const -> bool { return (_first[x >> 6] >> (x & 63)) & 1; }
+
+#if defined(TRIE_PREFILTER_AVX2)
+		// scan the offsets i with i + 32 < n, return the first exact
+		// candidate, or the first offset not scanned.
+		TRIE_PREFILTER_AVX2_TARGET
+		auto find_avx2(unsigned char const *p, std::size_t n, std::size_t i) const -> std::size_t {
+			// the same 16-byte table in both lanes, pshufb looks up per lane
+			auto const lo1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(_masks[0])));
+			auto const hi1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(_masks[1])));
+			auto const lo2 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(_masks[2])));
+			auto const hi2 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<__m128i const *>(_masks[3])));
+			auto const nibble = _mm256_set1_epi8(0x0f);
+			auto const zero = _mm256_setzero_si256();
+			for (; i + 32 < n; i += 32) {
+				auto const x = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i));
+				auto const y = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(p + i + 1));
+				auto r = _mm256_and_si256(_mm256_shuffle_epi8(lo1, _mm256_and_si256(x, nibble)),
+				                          _mm256_shuffle_epi8(hi1, _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble)));
+				r = _mm256_and_si256(r, _mm256_shuffle_epi8(lo2, _mm256_and_si256(y, nibble)));
+				r = _mm256_and_si256(r, _mm256_shuffle_epi8(hi2, _mm256_and_si256(_mm256_srli_epi16(y, 4), nibble)));
+				auto m = ~static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(r, zero)));
+				for (; m != 0; m &= m - 1) {
+					auto const j = i + std::size_t(std::countr_zero(m));
+					if (pair(p[j], p[j + 1])) return j;
+				}
+			}
+			return i;
+		}
+#endif
+
+	private:
+		std::uint64_t _pairs[65536 / 64]{}; // (first byte << 8 | second byte)
+		std::uint64_t _first[4]{};
+		alignas(16) std::uint8_t _masks[4][16]{}; // buckets by the nibbles: lo1, hi1, lo2, hi2
+		std::size_t _pair_count{};
+	}; // class literal_prefilter
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_PREFILTER_HH
@@ -0,0 +1,638 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_QUERY_HH
+#define TRIE_CXX_TRIE_QUERY_HH
+
+#include <algorithm>
+#include <bitset>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+// automaton
+namespace trie::query {
+	using byte_set = std::bitset<256>;
+
+	/**
+	 * @brief automaton is a pattern compiled to an NFA of byte classes
+	 * and run as a DFA built lazily, one state per set of NFA states
+	 * reached, so that a query only pays for the states it visits.
+	 * @details A state is an int: dead (0) accepts nothing whatever
+	 * follows, so a trie walk can prune the subtree. next() fills
+	 * the 256 transitions of a state on demand; the automaton is not
+	 * thread-safe, each query compiles its own.
+	 *
+	 * A pattern like `.*a.{20}` may reach millions of NFA sets, so
+	 * the states are cached up to max_states() only. Once full() the
+	 * caller flushes the cache, keeping the states it still holds, as
+	 * RE2 does when its DFA cache runs out.
+	 */
+	class automaton {
+	public:
+		using state_t = std::int32_t;
+		static constexpr state_t dead = 0;
+		// each state costs a row of 256 transitions, 1 KB
+		static constexpr std::size_t default_max_states = 4096;
+
+		// the NFA program, see compile_glob()
+		enum op_t : std::uint8_t {
+			OP_CLASS, // consume a byte of classes[cls], goto x
+			OP_SPLIT, // goto x and y
+			OP_MATCH, // accept
+		};
+		struct inst {
+			op_t op;
+			std::uint32_t x{}, y{};
+			std::uint32_t cls{};
+		};
+
+		automaton() = default;
+		// start is the index in prog of the first instruction
+		automaton(std::vector<inst> prog, std::vector<byte_set> classes, std::uint32_t start)
+		    : _prog(std::move(prog))
+		    , _classes(std::move(classes)) {
+			_words = (_prog.size() + 63) / 64;
+			add_state(std::vector<std::uint64_t>(_words)); // dead
+			std::vector<std::uint64_t> set(_words);
+			closure(set, start);
+			_start = add_state(std::move(set));
+		}
+
+		auto start() const -> state_t { return _start; }
+		auto next(state_t s, unsigned char c) -> state_t {
+			// step() may grow _trans, so never hold a reference across it
+			auto const i = std::size_t(s) * 256 + c;
+			if (_trans[i] < 0) {
+				auto const t = step(s, c);
+				_trans[i] = t;
+			}
+			return _trans[i];
+		}
+		auto accepting(state_t s) const -> bool { return _states[std::size_t(s)].accept; }
+		/**
+		 * @brief the bytes which lead s to a live state, sorted, if
+		 * there are a few of them only.
+		 * @return nullptr if more than 16 bytes may follow
+		 */
+		auto narrow(state_t s) const -> std::string const * {
+			auto const &st = _states[std::size_t(s)];
+			return st.wide ? nullptr : &st.bytes;
+		}
+		auto states() const -> std::size_t { return _states.size(); }
+
+		auto max_states() const -> std::size_t { return _max_states; }
+		auto max_states(std::size_t n) -> void { _max_states = std::max<std::size_t>(n, 8); }
+		auto full() const -> bool { return _states.size() >= _max_states; }
+		auto flushes() const -> std::size_t { return _flushes; }
+
+		/**
+		 * @brief drop all the states but dead, start and the @p live
+		 * ones, whose ids are updated in place.
+		 */
+		auto flush(std::vector<state_t> &live) -> void {
+			std::vector<std::vector<std::uint64_t>> sets;
+			sets.reserve(live.size());
+			for (auto s : live) sets.push_back(_states[std::size_t(s)].set);
+			auto start = std::move(_states[std::size_t(_start)].set);
+
+			_states.clear();
+			_trans.clear();
+			_index.clear();
+			add_state(std::vector<std::uint64_t>(_words)); // dead
+			_start = add_state(std::move(start));
+			for (std::size_t i = 0; i < live.size(); i++) live[i] = add_state(std::move(sets[i]));
+			_flushes++;
+		}
+
+		// run the automaton over text from the start state
+		auto matches(std::string_view text) -> bool {
+			auto s = _start;
+			std::vector<state_t> live;
+			for (auto c : text) {
+				if (full()) {
+					live.assign(1, s);
+					flush(live);
+					s = live.front();
+				}
+				if ((s = next(s, static_cast<unsigned char>(c))) == dead) return false;
+			}
+			return accepting(s);
+		}
+
+	private:
+		struct dstate {
+			std::vector<std::uint64_t> set;
+			bool accept{};
+			bool wide{};
+			std::string bytes{};
+		};
+
+		static auto has(std::vector<std::uint64_t> const &set, std::uint32_t i) -> bool { return (set[i >> 6] >> (i & 63)) & 1; }
+		// iterative, a chain of splits may be as long as the program
+		auto closure(std::vector<std::uint64_t> &set, std::uint32_t from) const -> void {
+			std::vector<std::uint32_t> todo{from};
+			while (!todo.empty()) {
+				auto const i = todo.back();
+				todo.pop_back();
+				if (has(set, i)) continue;
+				set[i >> 6] |= std::uint64_t(1) << (i & 63);
+				if (_prog[i].op == OP_SPLIT) {
+					todo.push_back(_prog[i].y);
+					todo.push_back(_prog[i].x);
+				}
+			}
+		}
+
+		auto step(state_t s, unsigned char c) -> state_t {
+			std::vector<std::uint64_t> to(_words);
+			auto const &from = _states[std::size_t(s)].set;
+			for (std::uint32_t i = 0; i < _prog.size(); i++) {
+				if (has(from, i) && _prog[i].op == OP_CLASS && _classes[_prog[i].cls][c])
+					closure(to, _prog[i].x);
+			}
+			return add_state(std::move(to));
+		}
+
+		auto add_state(std::vector<std::uint64_t> set) -> state_t {
+			std::string key(reinterpret_cast<char const *>(set.data()), set.size() * sizeof(std::uint64_t));
+			if (auto it = _index.find(key); it != _index.end()) return it->second;
+
+			dstate st;
+			byte_set live;
+			for (std::uint32_t i = 0; i < _prog.size(); i++) {
+				if (!has(set, i)) continue;
+				if (_prog[i].op == OP_MATCH) st.accept = true;
+				if (_prog[i].op == OP_CLASS) live |= _classes[_prog[i].cls];
+			}
+			st.wide = live.count() > 16;
+			for (unsigned c = 0; c < 256 && !st.wide; c++) {
+				if (live[c]) st.bytes += static_cast<char>(c);
+			}
+			st.set = std::move(set);
+
+			auto const id = state_t(_states.size());
+			_states.push_back(std::move(st));
+			_trans.resize(_states.size() * 256, -1);
+			_index.emplace(std::move(key), id);
+			if (id == dead) std::fill(_trans.begin(), _trans.end(), dead);
+			return id;
+		}
+
+	private:
+		std::vector<inst> _prog{};
+		std::vector<byte_set> _classes{};
+		std::size_t _words{};
+		std::vector<dstate> _states{};
+		std::vector<state_t> _trans{}; // 256 per state, -1 if not computed yet
+		std::unordered_map<std::string, state_t> _index{};
+		state_t _start{dead};
+		std::size_t _max_states{default_max_states};
+		std::size_t _flushes{};
+	}; // class automaton
+
+	/**
+	 * @brief compile a delimiter-aware glob pattern.
+	 * @details
+	 * - `*` matches any bytes within one segment, that is, no delimiter.
+	 * - `**` matches any bytes, across any number of segments. Followed
+	 *   by a delimiter, `**.` also matches nothing, so `app.**.file`
+	 *   matches "app.file" and "app.x.y.file".
+	 * - `?` matches one byte but the delimiter.
+	 * - `[abc]`, `[a-z]`, `[!a-z]` or `[^a-z]` match one byte of the
+	 *   class, never the delimiter.
+	 * - `\\` escapes the next byte, any other byte matches itself. An
+	 *   unterminated `[` matches itself too.
+	 */
+	inline auto compile_glob(std::string_view pattern, char delimiter = '.') -> automaton {
+		using inst = automaton::inst;
+		std::vector<inst> prog;
+		std::vector<byte_set> classes;
+		auto add_class = [&classes](byte_set const &set) {
+			for (std::uint32_t i = 0; i < classes.size(); i++) {
+				if (classes[i] == set) return i;
+			}
+			classes.push_back(set);
+			return std::uint32_t(classes.size() - 1);
+		};
+		auto emit = [&prog](automaton::op_t op, std::size_t x, std::size_t y = 0, std::uint32_t cls = 0) {
+			prog.push_back({op, std::uint32_t(x), std::uint32_t(y), cls});
+		};
+		byte_set all;
+		all.set();
+		auto segment = all;
+		segment.reset(static_cast<unsigned char>(delimiter));
+		auto const any_byte = add_class(all), segment_byte = add_class(segment);
+
+		for (std::size_t i = 0; i < pattern.size(); i++) {
+			auto const pc = prog.size();
+			auto const c = pattern[i];
+			if (c == '*' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+				i++;
+				if (i + 1 < pattern.size() && pattern[i + 1] == delimiter) {
+					// (any* delimiter)?
+					i++;
+					byte_set d;
+					d.set(static_cast<unsigned char>(delimiter));
+					emit(automaton::OP_SPLIT, pc + 1, pc + 4);
+					emit(automaton::OP_SPLIT, pc + 2, pc + 3);
+					emit(automaton::OP_CLASS, pc + 1, 0, any_byte);
+					emit(automaton::OP_CLASS, pc + 4, 0, add_class(d));
+				} else {
+					emit(automaton::OP_SPLIT, pc + 1, pc + 2);
+					emit(automaton::OP_CLASS, pc, 0, any_byte);
+				}
+				continue;
+			}
+			if (c == '*') {
+				emit(automaton::OP_SPLIT, pc + 1, pc + 2);
+				emit(automaton::OP_CLASS, pc, 0, segment_byte);
+				continue;
+			}
+			if (c == '?') {
+				emit(automaton::OP_CLASS, pc + 1, 0, segment_byte);
+				continue;
+			}
+
+			byte_set set;
+			if (auto const close = c == '[' ? pattern.find(']', i + 2) : std::string_view::npos; close != std::string_view::npos) {
+				auto j = i + 1;
+				bool const negate = pattern[j] == '!' || pattern[j] == '^';
+				if (negate) j++;
+				for (; j < close; j++) {
+					auto lo = static_cast<unsigned char>(pattern[j]), hi = lo;
+					if (j + 2 < close && pattern[j + 1] == '-') {
+						hi = static_cast<unsigned char>(pattern[j + 2]);
+						j += 2;
+					}
+					for (unsigned b = lo; b <= hi; b++) set.set(b);
+				}
+				if (negate) set.flip();
+				set &= segment;
+				i = close;
+			} else {
+				if (c == '\\' && i + 1 < pattern.size()) i++;
+				set.set(static_cast<unsigned char>(pattern[i]));
+			}
+			emit(automaton::OP_CLASS, pc + 1, 0, add_class(set));
+		}
+		emit(automaton::OP_MATCH, 0);
+		return automaton{std::move(prog), std::move(classes), 0};
+	}
+} // namespace trie::query
+
+// compile_regex
+namespace trie::query {
+	namespace detail {
+		// regex_parser parses a pattern into a tree of byte classes,
+		// concatenations, alternations and repetitions, and compiles
+		// it into an automaton with the Thompson construction.
+		class regex_parser {
+		public:
+			explicit regex_parser(std::string_view pattern)
+			    : _p(pattern) {}
+
+			auto compile() -> std::optional<automaton> {
+				if (_p.starts_with('^')) _pos++;
+				auto root = parse_alt();
+				if (_pos < _p.size() && _p[_pos] == '$' && _pos + 1 == _p.size()) _pos++;
+				if (!root || _pos != _p.size()) return fail();
+
+				auto const f = emit(*root);
+				if (!f) return fail();
+				patch(f->outs, std::uint32_t(_prog.size()));
+				_prog.push_back({automaton::OP_MATCH});
+				return automaton{std::move(_prog), std::move(_classes), f->start};
+			}
+			// the offset in the pattern where the parsing failed
+			auto error_pos() const -> std::size_t { return _pos; }
+
+		private:
+			enum kind_t { EMPTY, CLASS, CAT, ALT, REPEAT };
+			struct node {
+				kind_t kind{EMPTY};
+				byte_set set{};
+				std::vector<std::unique_ptr<node>> subs{};
+				int min{}, max{}; // max < 0 for no limit
+			};
+			using node_ptr = std::unique_ptr<node>;
+			static constexpr int max_repeat = 1000;
+			static constexpr int max_depth = 256; // of the groups
+			static constexpr std::size_t max_program = 1 << 16;
+
+			auto fail() -> std::optional<automaton> { return std::nullopt; }
+			auto eof() const -> bool { return _pos >= _p.size(); }
+			auto peek() const -> char { return _p[_pos]; }
+			static auto make(kind_t kind) -> node_ptr {
+				auto nd = std::make_unique<node>();
+				nd->kind = kind;
+				return nd;
+			}
+
+			auto parse_alt() -> node_ptr {
+				auto first = parse_cat();
+				if (!first || eof() || peek() != '|') return first;
+				auto alt = make(ALT);
+				alt->subs.push_back(std::move(first));
+				while (!eof() && peek() == '|') {
+					_pos++;
+					auto next = parse_cat();
+					if (!next) return nullptr;
+					alt->subs.push_back(std::move(next));
+				}
+				return alt;
+			}
+
+			auto parse_cat() -> node_ptr {
+				auto cat = make(CAT);
+				while (!eof() && peek() != '|' && peek() != ')') {
+					if (peek() == '$' && _pos + 1 == _p.size()) break;
+					auto atom = parse_repeat();
+					if (!atom) return nullptr;
+					cat->subs.push_back(std::move(atom));
+				}
+				if (cat->subs.size() == 1) return std::move(cat->subs.front());
+				return cat->subs.empty() ? make(EMPTY) : std::move(cat);
+			}
+
+			static auto is_quantifier(char c) -> bool { return c == '*' || c == '+' || c == '?' || c == '{'; }
+
+			// an atom with one quantifier at most: a lazy `a*?` or a
+			// stacked `a**` is rejected at the second quantifier.
+			auto parse_repeat() -> node_ptr {
+				auto atom = parse_atom();
+				if (!atom || eof() || !is_quantifier(peek())) return atom;
+				int min{}, max{};
+				auto const c = peek();
+				if (c == '*') min = 0, max = -1;
+				else if (c == '+') min = 1, max = -1;
+				else if (c == '?') min = 0, max = 1;
+				else if (!parse_bounds(min, max)) return nullptr;
+				if (c != '{') _pos++; // parse_bounds stops after '}'
+				if (!eof() && is_quantifier(peek())) return nullptr;
+				auto rep = make(REPEAT);
+				rep->min = min;
+				rep->max = max;
+				rep->subs.push_back(std::move(atom));
+				return rep;
+			}
+
+			// {m}, {m,} or {m,n}
+			auto parse_bounds(int &min, int &max) -> bool {
+				_pos++;
+				auto number = [this](int &n) {
+					auto const from = _pos;
+					for (n = 0; !eof() && peek() >= '0' && peek() <= '9' && n <= max_repeat; _pos++) n = n * 10 + (peek() - '0');
+					return _pos > from && n <= max_repeat;
+				};
+				if (!number(min)) return false;
+				max = min;
+				if (!eof() && peek() == ',') {
+					_pos++;
+					max = -1;
+					if (!eof() && peek() != '}' && !number(max)) return false;
+				}
+				if (eof() || peek() != '}' || (max >= 0 && max < min)) return false;
+				_pos++;
+				return true;
+			}
+
+			auto parse_atom() -> node_ptr {
+				auto const c = peek();
+				if (c == '(') {
+					if (++_depth > max_depth) return nullptr;
+					_pos++;
+					if (_p.substr(_pos).starts_with("?:")) _pos += 2;
+					auto inner = parse_alt();
+					if (!inner || eof() || peek() != ')') return nullptr;
+					_pos++;
+					_depth--;
+					return inner;
+				}
+				if (c == '*' || c == '+' || c == '?' || c == '{' || c == ')') return nullptr; // nothing to repeat
+				auto atom = make(CLASS);
+				if (c == '[') {
+					if (!parse_class(atom->set)) return nullptr;
+				} else if (c == '.') {
+					_pos++;
+					atom->set.set();
+				} else if (c == '\\') {
+					if (!parse_escape(atom->set)) return nullptr;
+				} else {
+					_pos++;
+					atom->set.set(static_cast<unsigned char>(c));
+				}
+				return atom;
+			}
+
+			auto parse_class(byte_set &set) -> bool {
+				_pos++;
+				bool const negate = !eof() && peek() == '^';
+				if (negate) _pos++;
+				for (bool first = true; !eof() && (first || peek() != ']'); first = false) {
+					byte_set item;
+					if (peek() == '\\') {
+						if (!parse_escape(item)) return false;
+					} else {
+						item.set(static_cast<unsigned char>(peek()));
+						_pos++;
+					}
+					// a range, if item is one byte and followed by '-x'
+					if (item.count() == 1 && _pos + 1 < _p.size() && peek() == '-' && _p[_pos + 1] != ']') {
+						unsigned lo{};
+						while (!item[lo]) lo++;
+						auto const hi = static_cast<unsigned char>(_p[_pos + 1]);
+						if (hi < lo) return false;
+						for (unsigned b = lo; b <= hi; b++) item.set(b);
+						_pos += 2;
+					}
+					set |= item;
+				}
+				if (eof()) return false;
+				_pos++;
+				if (negate) set.flip();
+				return true;
+			}
+
+			auto parse_escape(byte_set &set) -> bool {
+				if (++_pos >= _p.size()) return false;
+				auto const c = _p[_pos++];
+				auto range = [&set](unsigned char lo, unsigned char hi) {
+					for (unsigned b = lo; b <= hi; b++) set.set(b);
+				};
+				switch (c) {
+					case 'd':
+					case 'D': range('0', '9'); break;
+					case 'w':
+					case 'W':
+						range('0', '9'), range('A', 'Z'), range('a', 'z');
+						set.set('_');
+						break;
+					case 's':
+					case 'S':
+						for (auto b : {' ', '\t', '\n', '\r', '\f', '\v'}) set.set(static_cast<unsigned char>(b));
+						break;
+					case 'n': set.set('\n'); return true;
+					case 't': set.set('\t'); return true;
+					case 'r': set.set('\r'); return true;
+					default:
+						if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return false; // unsupported
+						set.set(static_cast<unsigned char>(c));
+						return true;
+				}
+				if (c == 'D' || c == 'W' || c == 'S') set.flip();
+				return true;
+			}
+
+			// Thompson construction, the dangling exits of a fragment are
+			// the x or y fields to patch with the next instruction.
+			struct frag {
+				std::uint32_t start;
+				std::vector<std::pair<std::uint32_t, bool>> outs; // (instruction, is y)
+			};
+			auto patch(std::vector<std::pair<std::uint32_t, bool>> const &outs, std::uint32_t target) -> void {
+				for (auto const &[i, y] : outs) (y ? _prog[i].y : _prog[i].x) = target;
+			}
+			auto add(automaton::op_t op, std::uint32_t cls = 0) -> std::uint32_t {
+				_prog.push_back({op, 0, 0, cls});
+				return std::uint32_t(_prog.size() - 1);
+			}
+			auto add_class(byte_set const &set) -> std::uint32_t {
+				for (std::uint32_t i = 0; i < _classes.size(); i++) {
+					if (_classes[i] == set) return i;
+				}
+				_classes.push_back(set);
+				return std::uint32_t(_classes.size() - 1);
+			}
+
+			auto emit(node const &nd) -> std::optional<frag> {
+				if (_prog.size() > max_program) return std::nullopt;
+				switch (nd.kind) {
+					case EMPTY: {
+						auto const i = add(automaton::OP_SPLIT);
+						return frag{i, {{i, false}, {i, true}}};
+					}
+					case CLASS: {
+						auto const i = add(automaton::OP_CLASS, add_class(nd.set));
+						return frag{i, {{i, false}}};
+					}
+					case CAT: {
+						auto f = emit(*nd.subs.front());
+						for (std::size_t k = 1; f && k < nd.subs.size(); k++) {
+							auto next = emit(*nd.subs[k]);
+							if (!next) return std::nullopt;
+							patch(f->outs, next->start);
+							f->outs = std::move(next->outs);
+						}
+						return f;
+					}
+					case ALT: {
+						auto f = emit(*nd.subs.front());
+						for (std::size_t k = 1; f && k < nd.subs.size(); k++) {
+							auto next = emit(*nd.subs[k]);
+							if (!next) return std::nullopt;
+							auto const i = add(automaton::OP_SPLIT);
+							_prog[i].x = f->start;
+							_prog[i].y = next->start;
+							f->start = i;
+							f->outs.insert(f->outs.end(), next->outs.begin(), next->outs.end());
+						}
+						return f;
+					}
+					case REPEAT: return emit_repeat(*nd.subs.front(), nd.min, nd.max);
+				}
+				return std::nullopt;
+			}
+
+			// sub{min,max}: min copies, then max - min optional copies, or
+			// a loop if max < 0.
+			auto emit_repeat(node const &sub, int min, int max) -> std::optional<frag> {
+				std::optional<frag> ret;
+				auto append = [&ret, this](frag f) {
+					if (!ret) {
+						ret = std::move(f);
+						return;
+					}
+					patch(ret->outs, f.start);
+					ret->outs = std::move(f.outs);
+				};
+				for (int k = 0; k < min; k++) {
+					auto f = emit(sub);
+					if (!f) return std::nullopt;
+					append(std::move(*f));
+				}
+				if (max < 0) {
+					auto f = emit(sub);
+					if (!f) return std::nullopt;
+					auto const i = add(automaton::OP_SPLIT);
+					_prog[i].x = f->start;
+					patch(f->outs, i);
+					append(frag{i, {{i, true}}});
+				} else {
+					// nested, so that a skipped copy skips the rest: (a(a)?)?
+					std::vector<std::uint32_t> splits;
+					for (int k = min; k < max; k++) {
+						auto const i = add(automaton::OP_SPLIT);
+						auto f = emit(sub);
+						if (!f) return std::nullopt;
+						_prog[i].x = f->start;
+						splits.push_back(i);
+						append(frag{i, std::move(f->outs)});
+					}
+					if (!ret) {
+						auto const i = add(automaton::OP_SPLIT);
+						return frag{i, {{i, false}, {i, true}}};
+					}
+					for (auto i : splits) ret->outs.emplace_back(i, true);
+				}
+				return ret;
+			}
+
+		private:
+			std::string_view _p;
+			std::size_t _pos{};
+			int _depth{}; // the nesting of the node being parsed
+			std::vector<automaton::inst> _prog{};
+			std::vector<byte_set> _classes{};
+		}; // class regex_parser
+	} // namespace detail
+
+	/**
+	 * @brief compile a restricted regular expression, which matches
+	 * a whole key, like std::regex_match.
+	 * @details The syntax is the common subset of ECMAScript and
+	 * POSIX ERE without backtracking features: literals, `.` (any
+	 * byte), `[a-z]`, `[^...]`, `\d \w \s \D \W \S`, groups `(...)`
+	 * and `(?:...)`, `|`, and the quantifiers `* + ? {m} {m,} {m,n}`
+	 * (up to 1000), one per atom. `^` and `$` are accepted at the
+	 * ends. Groups nest up to 256 levels. Backrefs, lookarounds, lazy
+	 * or stacked quantifiers and other escapes are rejected.
+	 * @param error_pos the offset where the parsing failed, if any
+	 * @return nullopt if the pattern is invalid or too large
+	 */
+	inline auto compile_regex(std::string_view pattern, std::size_t *error_pos = nullptr) -> std::optional<automaton> {
+		detail::regex_parser parser(pattern);
+		auto ret = parser.compile();
+		if (!ret && error_pos) *error_pos = parser.error_pos();
+		return ret;
+	}
+} // namespace trie::query
+
+#endif // TRIE_CXX_TRIE_QUERY_HH
@@ -0,0 +1,415 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_TRIE_SEGMENT_HH
+#define TRIE_CXX_TRIE_SEGMENT_HH
+
+#include <algorithm>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include "trie-intern.hh"
+#include "trie-node.hh"
+
+// segment_node
+namespace trie {
+	/**
+	 * @brief segment_node is the node type of segment_trie_t, whose
+	 * edges are whole segments of the keys.
+	 * @details A segment is interned in the intern_pool of the trie,
+	 * the node holds its id and a view into the pool, and the full
+	 * path is not stored but rebuilt from the parents on demand.
+	 * The children keep their insertion order, as a yaml file keeps
+	 * its keys. A child is found by the id of its segment: a few
+	 * children are scanned, more than scan_limit are indexed by an
+	 * open-addressing table (linear probing, at most half full) of
+	 * their ids and positions, so a lookup compares integers only.
+	 */
+	template<typename ValueT, char delimiter = '.'>
+	class segment_node final {
+	public:
+		using node_t = segment_node<ValueT, delimiter>;
+		using value_t = ValueT;
+		using node_ptr = std::unique_ptr<node_t>;
+		using children_t = std::vector<node_ptr>;
+		using id_t = intern_pool::id_t;
+
+		// the fanout from which the children are indexed by a table
+		static constexpr std::size_t scan_limit = 8;
+
+		segment_node() = default;
+		~segment_node() = default;
+		segment_node(node_t const &) = delete;
+		node_t &operator=(node_t const &) = delete;
+		explicit segment_node(std::string_view segment, id_t id, node_t *parent)
+		    : _segment(segment)
+		    , _id(id)
+		    , _parent(parent) {
+		}
+
+	public:
+		auto segment() const -> std::string_view { return _segment; } // the edge from the parent
+		auto id() const -> id_t { return _id; }                       // the interned id of segment()
+		// the full key, without a trailing delimiter, built from the parents
+		auto path() const -> std::string {
+			std::size_t length{};
+			for (auto const *p = this; p->_parent; p = p->_parent) length += p->_segment.size() + 1;
+			std::string ret(length ? length - 1 : 0, delimiter);
+			for (auto const *p = this; p->_parent; p = p->_parent) {
+				length -= p->_segment.size() + 1;
+				std::copy(p->_segment.begin(), p->_segment.end(), ret.begin() + std::ptrdiff_t(length));
+			}
+			return ret;
+		}
+		bool is_leaf() const { return _leaf; }
+		value_t &value() { return _value; } // empty for a branch node
+		value_t const &value() const { return _value; }
+		auto parent() const -> node_t const * { return _parent; }
+		auto children() const -> children_t const & { return _children; } // in insertion order
+
+		// the child whose segment has the interned id, O(1)
+		auto child(id_t id) const -> node_t const * { return child_of(this, id); }
+
+	private:
+		template<typename, char>
+		friend class segment_trie_t;
+
+		static auto slot_of(id_t id) -> std::size_t { return std::size_t((std::uint64_t(id) * 0x9e3779b97f4a7c15ull) >> 32); }
+
+		template<typename Self>
+		static auto child_of(Self *self, id_t id) -> Self * {
+			auto const &children = self->_children;
+			if (self->_table.empty()) {
+				for (auto const &ch : children) {
+					if (ch->_id == id) return ch.get();
+				}
+				return nullptr;
+			}
+			auto const mask = self->_table.size() - 1;
+			for (auto i = slot_of(id) & mask;; i = (i + 1) & mask) {
+				auto const &slot = self->_table[i];
+				if (slot.pos == 0) return nullptr;
+				if (slot.id == id) return children[slot.pos - 1].get();
+			}
+		}
+
+		auto add(node_ptr ch) -> node_t * {
+			auto *ret = ch.get();
+			_children.push_back(std::move(ch));
+			if (_children.size() <= scan_limit) return ret;
+			if (_table.size() < _children.size() * 2) {
+				reindex();
+			} else {
+				place(_children.size() - 1);
+			}
+			return ret;
+		}
+
+		auto del(node_t const *ch) -> node_ptr {
+			auto it = std::find_if(_children.begin(), _children.end(), [ch](auto const &p) { return p.get() == ch; });
+			if (it == _children.end()) return {};
+			auto ret = std::move(*it);
+			_children.erase(it); // shifts the positions after it
+			reindex();
+			return ret;
+		}
+
+		auto reindex() -> void {
+			_table.clear();
+			if (_children.size() <= scan_limit) return;
+			std::size_t capacity{16};
+			while (capacity < _children.size() * 2) capacity *= 2;
+			_table.assign(capacity, slot_t{});
+			for (std::size_t i = 0; i < _children.size(); i++) place(i);
+		}
+		auto place(std::size_t pos) -> void {
+			auto const mask = _table.size() - 1;
+			auto const id = _children[pos]->_id;
+			auto i = slot_of(id) & mask;
+			while (_table[i].pos != 0) i = (i + 1) & mask;
+			_table[i] = {std::uint32_t(pos + 1), id};
+		}
+
+	private:
+		struct slot_t {
+			std::uint32_t pos; // position + 1 in _children, 0 if empty
+			id_t id;
+		};
+
+		std::string_view _segment{}; // in the intern_pool of the trie
+		id_t _id{intern_pool::npos};
+		node_t *_parent{};
+		bool _leaf{};
+		value_t _value{};
+		children_t _children{};
+		std::vector<slot_t> _table{};
+	}; // class segment_node<...>
+} // namespace trie
+
+// segment_trie_t
+namespace trie {
+	/**
+	 * @brief A trie tree of delimited keys, whose edges are whole
+	 * segments: "app.logging.file" is the path app -> logging -> file.
+	 * @details trie_t splits its fragments at any byte, so the keys
+	 * "app.server.start" and "app.server.sites" share the node
+	 * "server.s", and a store lookup needs fix-ups at the delimiters.
+	 * segment_trie_t never splits a segment, a node is a whole level
+	 * of the hierarchy:
+	 *
+	 * - the segments are interned: each distinct segment such as
+	 *   `timeout` is stored once in the intern_pool of the trie, and
+	 *   a node holds its 32-bit id;
+	 * - a lookup costs one hash per segment to get its id (a segment
+	 *   never interned is a miss at once), then the children are
+	 *   found in O(1) by an integer compare;
+	 * - the children of a key, such as the items under
+	 *   `app.logging`, are directly the children of its node, in
+	 *   insertion order;
+	 * - a trailing delimiter is ignored, "app.logging." and
+	 *   "app.logging" are the same node.
+	 *
+	 * It is meant for config-style keys with short, repetitive
+	 * segments. For arbitrary byte strings trie_t shares more of the
+	 * common prefixes.
+	 * @code{c++}
+	 * trie::segment_trie_t<trie::value_t> tt;
+	 * tt.insert("app.logging.file", "~/.trie.log");
+	 * tt.insert("app.logging.rotate", 6);
+	 * if (auto const *nd = tt.locate("app.logging"))
+	 *   for (auto const &ch : nd->children()) std::cout << ch->segment() << '\n';
+	 * @endcode
+	 */
+	template<typename ValueT, char delimiter = '.'>
+	class segment_trie_t {
+	public:
+		using node_t = segment_node<ValueT, delimiter>;
+		using value_t = typename node_t::value_t;
+		using node_ptr = typename node_t::node_ptr;
+		using children_t = typename node_t::children_t;
+
+		struct return_s {
+			bool ok{};
+			errno_t en{};
+			value_t old{};
+		};
+
+		segment_trie_t()
+		    : _root(std::make_unique<node_t>()) {
+		}
+		~segment_trie_t() = default;
+		segment_trie_t(segment_trie_t const &) = delete;
+		segment_trie_t &operator=(segment_trie_t const &) = delete;
+		segment_trie_t(segment_trie_t &&) noexcept = default;
+		segment_trie_t &operator=(segment_trie_t &&) noexcept = default;
+
+	public:
+		/**
+		 * @brief insert or update a key.
+		 * @return the old value in return_s::old if the key existed
+		 */
+		template<typename... Args, std::enable_if_t<std::is_constructible_v<value_t, Args...>, bool> = true>
+		auto insert(std::string_view key, Args &&...args) -> return_s {
+			return_s ret{};
+			auto *nd = ensure(key);
+			if (!nd) {
+				ret.en = EINVAL;
+				return ret;
+			}
+			ret.old = std::exchange(nd->_value, value_t(std::forward<Args>(args)...));
+			if (!nd->_leaf) {
+				nd->_leaf = true;
+				_size++;
+			}
+			ret.ok = true;
+			return ret;
+		}
+		auto set(std::string_view key, value_t &&value) -> return_s { return insert(key, std::move(value)); }
+
+		/**
+		 * @brief remove a key.
+		 * @details A key with keys below it is removed together with
+		 * them if include_children, or else turned to a branch node.
+		 * The branches left without keys are removed too.
+		 * @return the removed value in return_s::old, ENOENT if the
+		 * key did not exist
+		 */
+		auto remove(std::string_view key, bool include_children = true) -> return_s;
+
+		/**
+		 * @brief the node of a key or of a branch, such as
+		 * "app.logging", O(1) per segment.
+		 * @return nullptr if no key begins with these segments
+		 */
+		auto locate(std::string_view key) const -> node_t const *;
+		auto locate(std::string_view key) -> node_t * { return const_cast<node_t *>(std::as_const(*this).locate(key)); }
+		// the child of nd whose segment is segment, O(1)
+		auto child(node_t const &nd, std::string_view segment) const -> node_t const * {
+			auto const id = _pool.find(segment);
+			return id == intern_pool::npos ? nullptr : nd.child(id);
+		}
+		// the value of a key, nullptr if not a key
+		auto find(std::string_view key) const -> value_t const * {
+			auto const *nd = locate(key);
+			return nd && nd->_leaf ? &nd->_value : nullptr;
+		}
+		auto has(std::string_view key) const -> bool { return find(key) != nullptr; }
+		auto get(std::string_view key, value_t const &default_val) const -> value_t const & {
+			auto const *v = find(key);
+			return v ? *v : default_val;
+		}
+
+		/**
+		 * @brief walk all nodes in pre-order, the children in insertion
+		 * order: visitor(node_t const &nd, int level). The root is not
+		 * visited.
+		 */
+		template<typename Visitor>
+		    requires std::is_invocable_v<Visitor &, node_t const &, int>
+		auto walk(Visitor &&visitor) const -> void {
+			std::vector<std::pair<node_t const *, int>> stack;
+			for (auto it = _root->_children.rbegin(); it != _root->_children.rend(); ++it) stack.emplace_back(it->get(), 0);
+			while (!stack.empty()) {
+				auto const [nd, level] = stack.back();
+				stack.pop_back();
+				visitor(*nd, level);
+				for (auto it = nd->_children.rbegin(); it != nd->_children.rend(); ++it) stack.emplace_back(it->get(), level + 1);
+			}
+		}
+
+		auto size() const -> std::size_t { return _size; } // count of keys, O(1)
+		auto empty() const -> bool { return _size == 0; }
+		auto root() const -> node_t const & { return *_root; }
+		auto pool() const -> intern_pool const & { return _pool; } // the interned segments
+
+		auto dump(std::ostream &os) const -> std::ostream &;
+
+	private:
+		// the segments of key, without a trailing delimiter
+		template<typename Fn>
+		static auto for_each_segment(std::string_view key, Fn &&fn) -> bool {
+			if (!key.empty() && key.back() == delimiter) key.remove_suffix(1);
+			if (key.empty()) return false;
+			for (std::size_t pos = 0;;) {
+				auto const end = key.find(delimiter, pos);
+				if (!fn(key.substr(pos, end - pos))) return false;
+				if (end == std::string_view::npos) return true;
+				pos = end + 1;
+			}
+		}
+		// find or build the node of key
+		auto ensure(std::string_view key) -> node_t *;
+
+	private:
+		intern_pool _pool{};
+		node_ptr _root;
+		std::size_t _size{};
+	}; // class segment_trie_t<...>
+} // namespace trie
+
+// segment_trie_t<...>
+namespace trie {
+	template<typename ValueT, char delimiter>
+	inline auto segment_trie_t<ValueT, delimiter>::
+	        ensure(std::string_view key) -> node_t * {
+		auto *nd = _root.get();
+		bool const ok = for_each_segment(key, [this, &nd](std::string_view segment) {
+			auto const id = _pool.intern(segment);
+			if (auto *ch = node_t::child_of(nd, id)) {
+				nd = ch;
+				return true;
+			}
+			nd = nd->add(std::make_unique<node_t>(_pool.view(id), id, nd));
+			return true;
+		});
+		return ok ? nd : nullptr;
+	}
+
+	template<typename ValueT, char delimiter>
+	inline auto segment_trie_t<ValueT, delimiter>::
+	        locate(std::string_view key) const -> node_t const * {
+		node_t const *nd = _root.get();
+		bool const ok = for_each_segment(key, [this, &nd](std::string_view segment) {
+			auto const id = _pool.find(segment);
+			nd = id == intern_pool::npos ? nullptr : node_t::child_of(nd, id);
+			return nd != nullptr;
+		});
+		return ok ? nd : nullptr;
+	}
+
+	template<typename ValueT, char delimiter>
+	inline auto segment_trie_t<ValueT, delimiter>::
+	        remove(std::string_view key, bool include_children) -> return_s {
+		return_s ret{};
+		auto *nd = locate(key);
+		if (!nd || !nd->_leaf) {
+			ret.en = ENOENT;
+			return ret;
+		}
+
+		ret.old = std::exchange(nd->_value, value_t{});
+		nd->_leaf = false;
+		_size--;
+		if (include_children) {
+			std::vector<node_t const *> stack{nd};
+			while (!stack.empty()) {
+				auto const *x = stack.back();
+				stack.pop_back();
+				for (auto const &ch : x->_children) {
+					if (ch->_leaf) _size--;
+					stack.push_back(ch.get());
+				}
+			}
+			nd->_children.clear();
+			nd->_table.clear();
+		}
+		// unlink the branches left without keys
+		while (nd != _root.get() && !nd->_leaf && nd->_children.empty()) {
+			auto *dad = nd->_parent;
+			dad->del(nd);
+			nd = dad;
+		}
+		ret.ok = true;
+		return ret;
+	}
+
+	template<typename ValueT, char delimiter>
+	inline auto segment_trie_t<ValueT, delimiter>::
+	        dump(std::ostream &os) const -> std::ostream & {
+		std::stringstream ss;
+		ss << "<root>\n";
+		walk([&ss](node_t const &nd, int level) {
+			auto const indent = (level + 1) * 2;
+			ss << std::setw(indent) << ' ' << std::left << std::setw(std::max(1, 32 - indent)) << nd.segment() << " -> ";
+			if (nd.is_leaf())
+				ss << "[L] (" << nd.path() << ") " << nd.value();
+			else
+				ss << "[B]";
+			ss << '\n';
+		});
+		return os << ss.str() << '\n';
+	}
+} // namespace trie
+
+#endif // TRIE_CXX_TRIE_SEGMENT_HH
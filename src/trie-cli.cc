@@ -12,13 +12,110 @@
 
 #include "trie-cxx.hh"
 
+#include <cstdlib>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <string>
+#include <vector>
 
 namespace {
+	// "a:b" or "a" into [lo, hi]
+	auto parse_range(std::string const &s, std::size_t &lo, std::size_t &hi) -> void {
+		auto const colon = s.find(':');
+		lo = std::strtoull(s.c_str(), nullptr, 10);
+		hi = colon == std::string::npos ? lo : std::strtoull(s.c_str() + colon + 1, nullptr, 10);
+	}
+
+	auto parse_list(std::string const &s) -> std::vector<std::size_t> {
+		std::vector<std::size_t> ret;
+		for (std::size_t pos = 0; pos <= s.size();) {
+			auto end = s.find(',', pos);
+			if (end == std::string::npos) end = s.size();
+			if (end > pos) ret.push_back(std::strtoull(s.substr(pos, end - pos).c_str(), nullptr, 10));
+			pos = end + 1;
+		}
+		return ret;
+	}
+
+	auto usage(std::ostream &os) -> int {
+		os << "Usage: trie-cli gen [options]\n"
+		   << "  writes a synthetic key set to stdout, one key per line\n\n"
+		   << "  --count N              keys to make (10000)\n"
+		   << "  --depth MIN:MAX        segments per key (2:5)\n"
+		   << "  --fanout A,B,C         children per node of each level, the last repeats (8,16,32)\n"
+		   << "  --segment MIN:MAX      bytes per segment (3:10)\n"
+		   << "  --length-dist D        uniform or geometric segment lengths (uniform)\n"
+		   << "  --shared R             chance to share a prefix with the previous key (0.5)\n"
+		   << "  --skew S               Zipf skew of the children chosen (0)\n"
+		   << "  --delimiter C          segment delimiter (.)\n"
+		   << "  --seed N               (1)\n"
+		   << "  --trace FILE           also write a query trace, lines of \"hit<TAB>key\"\n"
+		   << "  --queries N            queries in the trace (100000)\n"
+		   << "  --hit-ratio R          share of queries for existing keys (0.9)\n"
+		   << "  --zipf S               Zipf skew of the access to keys (0.99)\n";
+		return 2;
+	}
+
+	auto gen(int argc, char *argv[]) -> int {
+		trie::keygen::shape sh;
+		trie::keygen::trace_options opt;
+		std::string trace_file;
+		for (int i = 0; i < argc; i++) {
+			std::string const flag{argv[i]};
+			if (flag == "-h" || flag == "--help") return usage(std::cout), 0;
+			if (i + 1 >= argc) return usage(std::cerr);
+			std::string const value{argv[++i]};
+			if (flag == "--count")
+				sh.count = std::strtoull(value.c_str(), nullptr, 10);
+			else if (flag == "--depth")
+				parse_range(value, sh.min_depth, sh.max_depth);
+			else if (flag == "--fanout")
+				sh.fanout = parse_list(value);
+			else if (flag == "--segment")
+				parse_range(value, sh.min_segment, sh.max_segment);
+			else if (flag == "--length-dist" && (value == "uniform" || value == "geometric"))
+				sh.lengths = value == "uniform" ? trie::keygen::length_dist::uniform : trie::keygen::length_dist::geometric;
+			else if (flag == "--shared")
+				sh.shared_prefix = std::atof(value.c_str());
+			else if (flag == "--skew")
+				sh.segment_skew = std::atof(value.c_str());
+			else if (flag == "--delimiter" && value.size() == 1)
+				sh.delimiter = opt.delimiter = value[0];
+			else if (flag == "--seed")
+				sh.seed = opt.seed = std::strtoull(value.c_str(), nullptr, 10);
+			else if (flag == "--trace")
+				trace_file = value;
+			else if (flag == "--queries")
+				opt.count = std::strtoull(value.c_str(), nullptr, 10);
+			else if (flag == "--hit-ratio")
+				opt.hit_ratio = std::atof(value.c_str());
+			else if (flag == "--zipf")
+				opt.skew = std::atof(value.c_str());
+			else
+				return usage(std::cerr);
+		}
+
+		auto const keys = trie::keygen::make_keys(sh);
+		for (auto const &k : keys) std::cout << k << '\n';
+		if (keys.size() < sh.count)
+			std::cerr << "trie-cli: the shape holds " << keys.size() << " keys only, of " << sh.count << '\n';
+
+		if (!trace_file.empty()) {
+			std::ofstream ofs(trace_file);
+			if (!ofs) {
+				std::cerr << "trie-cli: cannot write " << trace_file << '\n';
+				return 1;
+			}
+			for (auto const &q : trie::keygen::make_trace(keys, opt)) ofs << (q.hit ? '1' : '0') << '\t' << q.key << '\n';
+		}
+		return 0;
+	}
 } // namespace
 
-int main() {
+int main(int argc, char *argv[]) {
+	if (argc > 1 && std::string{argv[1]} == "gen") return gen(argc - 2, argv + 2);
+
 	std::cout << "Hello, World!" << '\n'
 			// << "I was built by " << trie::cross::compiler_name() << '\n'
 			<< "__cplusplus = 0x" << std::hex << std::setfill('0') << std::setw(8) << __cplusplus << ' ' << '(' << std::dec <<
@@ -18,6 +18,8 @@
 
 // #include "trie-cxx/trie-chrono.hh"
 
+#include "x-bench.hh"
+
 #include <random>
 
 namespace trie::tests {
@@ -187,6 +189,53 @@ namespace trie::tests {
 
 		test5_bench_finds(tt, keys, MAX_FINDS);
 	}
+
+	// time and allocations per operation of the hot paths, insert and
+	// remove included, on one set of dotted keys; and the hardware
+	// counters with TRIE_BENCH_PERF=1.
+	void test5_benchmem(std::size_t count = 100000) {
+		if (trie::bench::hw_counters_wanted() && !trie::bench::thread_hw_counters().error().empty())
+			std::cout << "(hardware counters: " << trie::bench::thread_hw_counters().error() << ")" << '\n';
+		std::mt19937 rng(7);
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics", "ui"};
+		std::vector<std::string> keys;
+		keys.reserve(count);
+		for (std::size_t i = 0; i < count; i++)
+			keys.push_back(std::string("app.") + sections[rng() % 8] + ".k" + std::to_string(rng() % (count * 4)));
+
+		trie::trie_t<trie::value_t> tt;
+		std::cout << trie::bench::measure("insert", count, [&] {
+			for (auto const &k : keys) tt.insert(k.c_str(), 1);
+		}) << '\n';
+		std::cout << trie::bench::measure("insert (update)", count, [&] {
+			for (auto const &k : keys) tt.insert(k.c_str(), 2);
+		}) << '\n';
+
+		std::size_t hits{};
+		std::cout << trie::bench::measure("fast_find", count, [&] {
+			for (auto const &k : keys) hits += std::as_const(tt).fast_find(k.c_str()).matched;
+		}) << '\n';
+		std::cout << trie::bench::measure("locate", count, [&] {
+			for (auto const &k : keys) hits += tt.locate(k.c_str()).matched;
+		}) << '\n';
+
+		std::size_t leaves{};
+		std::cout << trie::bench::measure("walk (per key)", tt.size(), [&] {
+			tt.walk([&leaves](auto const &nd, int, int) {
+				if (nd.type() == trie::trie_t<trie::value_t>::node_t::NODE_LEAF) leaves++;
+			});
+		}) << '\n';
+		std::cout << trie::bench::measure("walk(walk_cb) (per key)", tt.size(), [&] {
+			tt.walk([&leaves](auto type, auto, int, int) {
+				if (type == trie::trie_t<trie::value_t>::node_t::NODE_LEAF) leaves++;
+			});
+		}) << '\n';
+
+		std::cout << trie::bench::measure("remove", count, [&] {
+			for (auto const &k : keys) tt.remove(k.c_str());
+		}) << '\n';
+		std::cout << "(hits: " << hits << ", leaves: " << leaves << ", left: " << tt.size() << ")" << '\n';
+	}
 } // namespace trie::tests
 
 int main() {
@@ -195,5 +244,6 @@ int main() {
 	test2();
 	test3();
 	test5_bench_inserts_and_finds();
+	test5_benchmem();
 	return 0;
 }
@@ -520,3 +520,227 @@ SCENARIO("trie/store: unit tests", "[trie][unit-test]") {
 //
 // 	return 0;
 // }
+
+SCENARIO("trie/store: subtree leaf counts", "[trie][size]") {
+	using namespace trie::tests;
+	auto tt = build_minimal_trie(); // these common codes will be re-exec'd before each GIVEN starting
+
+	REQUIRE(tt.size() == 8);
+	REQUIRE(tt.count_prefix("") == 8);
+	REQUIRE(tt.count_prefix("app.") == 8);
+	REQUIRE(tt.count_prefix("app.logging.") == 3);
+	REQUIRE(tt.count_prefix("app.lo") == 3);
+	REQUIRE(tt.count_prefix("app.server.s") == 2);
+	REQUIRE(tt.count_prefix("app.d") == 2);
+	REQUIRE(tt.count_prefix("app.x") == 0);
+
+	GIVEN("splitting a node which has children") {
+		// "app.server.s" is a branch with "tart" and "ites", splitting
+		// it shall keep both children reachable.
+		tt.insert("app.server.port", 8080);
+		tt.insert("app.se", 1);
+		REQUIRE(tt.size() == 10);
+		REQUIRE(tt.count_prefix("app.server.") == 3);
+		REQUIRE(tt.count_prefix("app.se") == 4);
+		REQUIRE(tt.has("app.server.start"));
+		REQUIRE(tt.has("app.server.sites"));
+		REQUIRE(tt.get<int>("app.server.port") == 8080);
+		REQUIRE(tt.get<int>("app.server.start") == 5);
+		REQUIRE(tt.get<int>("app.se") == 1);
+	}
+
+	GIVEN("a key ending inside a fragment") {
+		tt.insert("app.server.s", 7);
+		REQUIRE(tt.size() == 9);
+		REQUIRE(tt.get<int>("app.server.s") == 7);
+		REQUIRE(tt.count_prefix("app.server.s") == 3);
+
+		tt.insert("app.server.s", 8); // update only
+		REQUIRE(tt.size() == 9);
+	}
+
+	GIVEN("removing keys") {
+		tt.remove("app.logging.words");
+		REQUIRE(tt.size() == 7);
+		REQUIRE(tt.count_prefix("app.logging.") == 2);
+
+		tt.remove("app.logging.");
+		REQUIRE(tt.size() == 5);
+		REQUIRE(tt.count_prefix("app.logging") == 0);
+
+		// merging "app.server.s" with its last child
+		tt.remove("app.server.sites");
+		REQUIRE(tt.size() == 4);
+		REQUIRE(tt.has("app.server.start"));
+		REQUIRE(tt.count_prefix("app.server.") == 1);
+
+		tt.insert("app.logging.file", "~/.trie.log");
+		REQUIRE(tt.size() == 5);
+	}
+}
+
+SCENARIO("trie/store: longest prefix match", "[trie][lpm]") {
+	using namespace trie::tests;
+	auto tt = build_minimal_trie(); // these common codes will be re-exec'd before each GIVEN starting
+	tt.insert("app", 1);
+	tt.insert("app.log", 2);
+	tt.insert("app.logging", 3);
+
+	GIVEN("byte-wise matching") {
+		auto ret = tt.longest_prefix_match("app.logging.file.name");
+		REQUIRE(ret.matched);
+		REQUIRE(ret.matched_length == 16);
+		REQUIRE(ret.ptr->path() == "app.logging.file");
+
+		ret = tt.longest_prefix_match("app.logging.level");
+		REQUIRE(ret.matched_length == 11);
+		REQUIRE(std::get<int>(ret.ptr->value()) == 3);
+
+		ret = tt.longest_prefix_match("app.logfile");
+		REQUIRE(ret.matched_length == 7);
+		REQUIRE(std::get<int>(ret.ptr->value()) == 2);
+
+		ret = tt.longest_prefix_match("app.lo"); // ends inside a fragment
+		REQUIRE(ret.matched_length == 3);
+
+		REQUIRE(tt.longest_prefix_match("app.server.start").matched_length == 16);
+		REQUIRE_FALSE(tt.longest_prefix_match("ap").matched);
+		REQUIRE_FALSE(tt.longest_prefix_match("").matched);
+		REQUIRE_FALSE(tt.longest_prefix_match("bob").matched);
+	}
+
+	GIVEN("delimiter-aligned matching") {
+		auto ret = tt.longest_path_match("app.logfile");
+		REQUIRE(ret.matched_length == 3);
+		REQUIRE(std::get<int>(ret.ptr->value()) == 1);
+
+		ret = tt.longest_path_match("app.logging.level");
+		REQUIRE(ret.matched_length == 11);
+
+		REQUIRE(tt.longest_path_match("app.log").matched_length == 7);
+		REQUIRE(tt.longest_path_match("app.server.startup").matched_length == 3);
+
+		tt.insert("app.server.", 4); // the key ends with a delimiter
+		REQUIRE(tt.longest_path_match("app.server.startup").matched_length == 11);
+		REQUIRE_FALSE(tt.longest_path_match("application").matched);
+	}
+
+	GIVEN("updating the matched value") {
+		auto ret = tt.longest_path_match("app.logging.level");
+		ret.ptr->value(std::string("handler"));
+		REQUIRE(tt.get<std::string>("app.logging") == "handler");
+	}
+}
+
+namespace trie::tests {
+	// a value counting its copies and moves
+	struct counted {
+		static inline int copies{}, moves{};
+		static void reset() { copies = moves = 0; }
+
+		std::string text{};
+		counted() = default;
+		explicit counted(std::string s)
+		    : text(std::move(s)) {}
+		counted(std::size_t n, char c)
+		    : text(n, c) {}
+		counted(counted const &o)
+		    : text(o.text) { copies++; }
+		counted(counted &&o) noexcept
+		    : text(std::move(o.text)) { moves++; }
+		counted &operator=(counted const &o) {
+			text = o.text;
+			copies++;
+			return *this;
+		}
+		counted &operator=(counted &&o) noexcept {
+			text = std::move(o.text);
+			moves++;
+			return *this;
+		}
+	};
+} // namespace trie::tests
+
+SCENARIO("trie/store: copies and moves of values", "[trie][emplace]") {
+	using namespace trie::tests;
+	using counted_store = trie::trie_t<counted>;
+	counted_store tt;
+	tt.insert("app.server.start", counted{"5"});
+	tt.insert("app.server.sites", counted{"1"});
+
+	GIVEN("insert and set move the value once") {
+		counted::reset();
+		tt.insert(std::string("app.logging.file"), counted{"~/.trie.log"});
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1);
+
+		counted::reset();
+		tt.set("app.cache", counted{"6"});
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1);
+
+		counted::reset();
+		auto ret = tt.update("app.cache", counted{"7"});
+		REQUIRE(ret.ok);
+		REQUIRE(ret.old.text == "6");
+		REQUIRE(counted::copies == 0);
+		REQUIRE(tt.get("app.cache").lock()->value().text == "7");
+		REQUIRE_FALSE(tt.update("app.logging.level", counted{"x"}).ok);
+	}
+
+	GIVEN("try_emplace constructs in place, or not at all") {
+		counted::reset();
+		auto r = tt.try_emplace("app.logging.words", std::size_t(3), 'w'); // a new leaf
+		REQUIRE((r.ok && r.inserted));
+		REQUIRE(r.value().text == "www");
+		r = tt.try_emplace("app.client", std::size_t(2), 'c'); // splitting a branch
+		REQUIRE((r.ok && r.inserted));
+		REQUIRE(r.value().text == "cc");
+		REQUIRE(counted::copies + counted::moves == 0);
+
+		// a key ending inside a fragment turns the split point into a
+		// leaf, whose value is made first and then moved in
+		r = tt.try_emplace("app.server.", std::size_t(1), 'b');
+		REQUIRE((r.ok && r.inserted));
+		REQUIRE(r.value().text == "b");
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1);
+		counted::reset();
+
+		counted v{"kept"};
+		r = tt.try_emplace("app.server.start", std::move(v));
+		REQUIRE((r.ok && !r.inserted));
+		REQUIRE(r.value().text == "5");
+		REQUIRE(v.text == "kept"); // not moved from
+		REQUIRE(counted::copies + counted::moves == 0);
+
+		r.value().text = "changed";
+		REQUIRE(tt.get("app.server.start").lock()->value().text == "changed");
+		REQUIRE(tt.size() == 5);
+		REQUIRE_FALSE(tt.try_emplace("", std::size_t(1), 'x').ok);
+	}
+
+	GIVEN("insert_or_assign and emplace on an existing key") {
+		counted::reset();
+		counted v{"assigned"};
+		auto r = tt.insert_or_assign("app.server.start", std::move(v));
+		REQUIRE((r.ok && !r.inserted));
+		REQUIRE(r.value().text == "assigned");
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1); // one move assignment
+
+		counted::reset();
+		r = tt.insert_or_assign("app.client", counted{"new"});
+		REQUIRE((r.ok && r.inserted));
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1); // one move construction
+
+		counted::reset();
+		r = tt.emplace("app.server.sites", std::size_t(2), 'e');
+		REQUIRE((r.ok && !r.inserted));
+		REQUIRE(r.value().text == "ee");
+		REQUIRE(counted::copies == 0);
+		REQUIRE(counted::moves == 1); // the temporary, move-assigned
+		REQUIRE(tt.size() == 3);
+	}
+}
@@ -0,0 +1,161 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-ac.hh"
+#include "trie-cxx/trie-core.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+// Dictionary scanning benchmark of ac_matcher: the plain byte-by-byte
+// automaton against the same automaton with the literal prefilter,
+// and the prefiltered scan of chunks in parallel.
+//
+// Run this:
+//
+//    ./bin/test-trie-ac-bench [megabytes] [rounds]
+//
+// Two texts are generated: English-like prose scanned for capitalized
+// names, and log lines scanned for error codes and exception names.
+// Build with -DTRIE_DISABLE_SIMD to compare with the scalar prefilter.
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+	using matcher = trie::ac_matcher<store>;
+
+	char const *const english_words[] = {
+	        "the", "of", "and", "to", "in", "is", "was", "that", "for", "it", "with", "as", "his", "on", "be",
+	        "at", "by", "had", "are", "but", "from", "or", "have", "an", "they", "which", "one", "you", "were",
+	        "all", "we", "her", "she", "there", "would", "their", "will", "when", "who", "him", "been", "has",
+	        "more", "if", "no", "out", "so", "said", "what", "up", "its", "about", "than", "into", "them", "can",
+	        "only", "other", "time", "new", "some", "could", "these", "two", "may", "first", "then", "do", "any",
+	        "like", "my", "now", "over", "such", "our", "man", "me", "even", "most", "made", "after", "also",
+	        "did", "many", "before", "must", "through", "back", "years", "where", "much", "your", "way", "well",
+	        "down", "should", "because", "each", "just", "those", "people", "how", "too", "little", "state",
+	        "good", "very", "make", "world", "still", "own", "see", "men", "work", "long", "get", "here", "between",
+	};
+
+	inline auto random_name(std::mt19937_64 &rng) -> std::string {
+		std::string name(1, char('A' + rng() % 26));
+		for (auto len = 4 + rng() % 6; len > 0; len--) name += char('a' + rng() % 26);
+		return name;
+	}
+
+	inline auto english_text(std::size_t size, std::vector<std::string> const &names, std::mt19937_64 &rng) -> std::string {
+		std::string text;
+		text.reserve(size + 64);
+		bool sentence{true};
+		while (text.size() < size) {
+			std::string word = rng() % 50 == 0 ? names[rng() % names.size()] : english_words[rng() % std::size(english_words)];
+			if (sentence) word[0] = char(std::toupper(word[0]));
+			text += word;
+			sentence = rng() % 12 == 0;
+			text += sentence ? ". " : rng() % 8 == 0 ? ", " : " ";
+		}
+		return text;
+	}
+
+	inline auto log_text(std::size_t size, std::vector<std::string> const &errors, std::mt19937_64 &rng) -> std::string {
+		static char const *levels[] = {"INFO ", "DEBUG", "INFO ", "WARN "};
+		static char const *paths[] = {"/api/v1/users/", "/api/v1/orders/", "/static/js/app.", "/healthz?probe=", "/api/v2/search?q="};
+		std::string text;
+		text.reserve(size + 256);
+		while (text.size() < size) {
+			auto const ms = rng() % 86400000;
+			text += "2024-09-16T" + std::to_string(ms / 3600000 + 10) + ":" + std::to_string(ms / 60000 % 60 + 10) + ":" +
+			        std::to_string(ms / 1000 % 60 + 10) + "." + std::to_string(ms % 1000) + "Z ";
+			if (rng() % 100 == 0) {
+				text += "ERROR [worker-" + std::to_string(rng() % 16) + "] " + errors[rng() % errors.size()] + " while serving request\n";
+				continue;
+			}
+			text += levels[rng() % std::size(levels)];
+			text += " [worker-" + std::to_string(rng() % 16) + "] GET ";
+			text += paths[rng() % std::size(paths)] + std::to_string(rng() % 100000);
+			text += " 200 " + std::to_string(rng() % 900) + "ms\n";
+		}
+		return text;
+	}
+
+	template<typename Fn>
+	auto best_of(int rounds, Fn &&fn) -> double {
+		double best{-1};
+		for (int i = 0; i < rounds; i++) {
+			double ms{};
+			{
+				trie::chrono::timer tr([&ms](auto duration) -> bool {
+					ms = duration;
+					return false;
+				});
+				fn();
+			}
+			if (best < 0 || ms < best) best = ms;
+		}
+		return best;
+	}
+
+	void bench_dictionary(char const *title, std::vector<std::string> const &keys, std::string const &text, int rounds) {
+		store tt;
+		for (std::size_t i = 0; i < keys.size(); i++) tt.insert(keys[i].c_str(), int(i));
+		matcher ac(tt);
+		trie::literal_prefilter pf;
+		for (auto const &key : keys) pf.add(key);
+		std::cout << title << ": " << tt.size() << " keys, " << ac.states() << " states, text " << (text.size() >> 20)
+		          << "MB, candidate pairs " << (pf.density() * 100) << "%, avx2 " << trie::literal_prefilter::simd() << '\n';
+
+		auto report = [&text](char const *what, double ms, std::size_t found) {
+			std::cout << "  " << what << ": " << ms << "ms, " << (double(text.size()) / ms / 1000.0) << " MB/s (matches: " << found << ")" << '\n';
+		};
+
+		std::size_t found{};
+		auto count = [&found](matcher::match_s const &) { found++; };
+		ac.prefilter(false);
+		auto ms = best_of(rounds, [&] {
+			found = 0;
+			ac.scan(text, count);
+		});
+		report("byte-by-byte       ", ms, found);
+
+		ac.prefilter(true);
+		ms = best_of(rounds, [&] {
+			found = 0;
+			ac.scan(text, count);
+		});
+		report("prefilter          ", ms, found);
+
+		ms = best_of(rounds, [&] { found = ac.parallel_find_all(text).size(); });
+		report("prefilter, parallel", ms, found);
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	using namespace trie::tests;
+	std::size_t megabytes{32};
+	int rounds{3};
+	if (argc > 1) megabytes = std::size_t(std::max(1, std::atoi(argv[1])));
+	if (argc > 2) rounds = std::max(1, std::atoi(argv[2]));
+
+	std::mt19937_64 rng(7);
+	std::vector<std::string> names;
+	for (int i = 0; i < 2000; i++) names.push_back(random_name(rng));
+	bench_dictionary("english, names", names, english_text(megabytes << 20, names, rng), rounds);
+
+	std::vector<std::string> errors;
+	for (int i = 0; i < 1000; i++) errors.push_back("E" + std::to_string(1000 + i) + ":");
+	for (auto const *e : {"panic:", "Timeout", "OutOfMemoryError", "NullPointerException", "deadlock", "SIGSEGV", "ECONNRESET"})
+		errors.emplace_back(e);
+	bench_dictionary("logs, error codes", errors, log_text(megabytes << 20, errors, rng), rounds);
+	return 0;
+}
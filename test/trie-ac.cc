@@ -0,0 +1,222 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "trie-cxx/trie-ac.hh"
+#include "trie-cxx/trie-core.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+	using matcher = trie::ac_matcher<store>;
+	using occurrence = std::tuple<std::size_t, std::string>; // end position, key
+
+	inline auto collect(matcher const &ac, std::string_view text) -> std::vector<occurrence> {
+		std::vector<occurrence> ret;
+		for (auto const &m : ac.find_all(text)) {
+			REQUIRE(text.substr(m.pos, m.length) == m.node->path());
+			ret.emplace_back(m.pos + m.length, m.node->path());
+		}
+		return ret;
+	}
+
+	// try every key at every offset
+	inline auto brute_force(std::set<std::string> const &keys, std::string_view text) -> std::vector<occurrence> {
+		std::vector<occurrence> ret;
+		for (std::size_t i = 0; i < text.size(); i++) {
+			for (auto const &key : keys) {
+				if (text.substr(i).starts_with(key)) ret.emplace_back(i + key.size(), key);
+			}
+		}
+		std::sort(ret.begin(), ret.end(), [](auto const &a, auto const &b) {
+			return std::get<0>(a) != std::get<0>(b) ? std::get<0>(a) < std::get<0>(b) : std::get<1>(a).size() > std::get<1>(b).size();
+		});
+		return ret;
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/ac: aho-corasick matcher", "[trie][ac]") {
+	using namespace trie::tests;
+
+	GIVEN("the classic dictionary") {
+		store tt;
+		tt.insert("he", 1);
+		tt.insert("she", 2);
+		tt.insert("his", 3);
+		tt.insert("hers", 4);
+		matcher const ac(tt);
+		REQUIRE(ac.patterns() == 4);
+		REQUIRE(ac.max_length() == 4);
+
+		auto found = ac.find_all("ushers");
+		REQUIRE(found.size() == 3);
+		REQUIRE((found[0].pos == 1 && found[0].length == 3 && std::get<int>(found[0].node->value()) == 2));
+		REQUIRE((found[1].pos == 2 && found[1].length == 2 && std::get<int>(found[1].node->value()) == 1));
+		REQUIRE((found[2].pos == 2 && found[2].length == 4 && std::get<int>(found[2].node->value()) == 4));
+
+		int n{0};
+		REQUIRE_FALSE(ac.scan("hehehe", [&n](auto const &) { return ++n < 2; }));
+		REQUIRE(n == 2);
+		REQUIRE(ac.find_all("").empty());
+		REQUIRE(ac.find_all("xyz").empty());
+	}
+
+	GIVEN("an empty dictionary") {
+		store tt;
+		matcher const ac(tt);
+		REQUIRE(ac.patterns() == 0);
+		REQUIRE(ac.find_all("anything").empty());
+	}
+
+	GIVEN("random keys and texts against a brute-force scan") {
+		std::mt19937 rng(3);
+		char const alphabet[] = "ab.c";
+		for (unsigned hot_depth : {0u, 1u, 3u, 64u}) {
+			store tt;
+			std::set<std::string> keys;
+			for (int i = 0; i < 60; i++) {
+				std::string key;
+				for (auto len = 1 + rng() % 5; len > 0; len--) key += alphabet[rng() % (sizeof(alphabet) - 1)];
+				tt.insert(key.c_str(), i);
+				keys.insert(key);
+			}
+			matcher const ac(tt, hot_depth);
+			REQUIRE(ac.patterns() == keys.size());
+			for (int round = 0; round < 20; round++) {
+				std::string text;
+				for (auto len = rng() % 300; len > 0; len--) text += alphabet[rng() % (sizeof(alphabet) - 1)];
+				REQUIRE(collect(ac, text) == brute_force(keys, text));
+			}
+		}
+	}
+}
+
+SCENARIO("trie/ac: streaming and chunk-parallel scanning", "[trie][ac][stream]") {
+	using namespace trie::tests;
+	std::mt19937 rng(11);
+	char const alphabet[] = "abc.";
+	store tt;
+	for (int i = 0; i < 200; i++) {
+		std::string key;
+		for (auto len = 1 + rng() % 12; len > 0; len--) key += alphabet[rng() % (sizeof(alphabet) - 1)];
+		tt.insert(key.c_str(), i);
+	}
+	matcher const ac(tt);
+	std::string text;
+	for (int i = 0; i < 20000; i++) text += alphabet[rng() % (sizeof(alphabet) - 1)];
+	auto const expected = ac.find_all(text);
+	REQUIRE(expected.size() > 1000);
+
+	auto same = [](std::vector<matcher::match_s> const &a, std::vector<matcher::match_s> const &b) {
+		return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](auto const &x, auto const &y) {
+			return x.pos == y.pos && x.length == y.length && x.node == y.node;
+		});
+	};
+
+	GIVEN("chunks of random sizes fed to a stream") {
+		auto st = ac.make_stream();
+		std::vector<matcher::match_s> found;
+		for (std::size_t pos = 0; pos < text.size();) {
+			auto const n = std::min<std::size_t>(rng() % 20, text.size() - pos);
+			REQUIRE(st.feed(std::string_view(text).substr(pos, n), [&found](auto const &m) { found.push_back(m); }));
+			pos += n;
+		}
+		REQUIRE(st.offset() == text.size());
+		REQUIRE(same(found, expected));
+
+		st.reset();
+		found.clear();
+		st.feed("ab", [&found](auto const &m) { found.push_back(m); });
+		REQUIRE(st.offset() == 2);
+	}
+
+	GIVEN("an input stream read in small buffers") {
+		std::istringstream is(text);
+		std::vector<matcher::match_s> found;
+		REQUIRE(ac.scan(is, [&found](auto const &m) { found.push_back(m); }, 7));
+		REQUIRE(same(found, expected));
+	}
+
+	GIVEN("chunks scanned in parallel") {
+		trie::pool::thread_pool pool(4);
+		for (std::size_t chunk : {1u, 5u, 11u, 12u, 13u, 100u, 4096u, 100000u}) {
+			REQUIRE(same(ac.parallel_find_all(text, pool, chunk), expected));
+		}
+		REQUIRE(same(ac.parallel_find_all(text), expected));
+		REQUIRE(ac.parallel_find_all("", pool, 3).empty());
+	}
+}
+
+SCENARIO("trie/ac: literal prefilter", "[trie][ac][prefilter]") {
+	using namespace trie::tests;
+	std::mt19937 rng(29);
+
+	GIVEN("random bytes with planted keys") {
+		store tt;
+		std::set<std::string> keys;
+		for (int i = 0; i < 300; i++) {
+			std::string key;
+			for (auto len = 1 + rng() % 8; len > 0; len--) key += char('A' + rng() % 40);
+			tt.insert(key.c_str(), i);
+			keys.insert(key);
+		}
+		matcher ac(tt);
+		REQUIRE(ac.prefilter());
+
+		std::string text;
+		for (int i = 0; i < 50000; i++) {
+			if (rng() % 64 == 0)
+				text += *std::next(keys.begin(), std::ptrdiff_t(rng() % keys.size()));
+			else
+				text += char(rng() % 256);
+		}
+		auto const expected = brute_force(keys, text);
+		REQUIRE(collect(ac, text) == expected);
+
+		// every offset where a key begins is a candidate
+		trie::literal_prefilter pf;
+		for (auto const &key : keys) pf.add(key);
+		std::set<std::size_t> starts;
+		for (auto const &[end, key] : expected) starts.insert(end - key.size());
+		std::size_t candidates{};
+		for (auto i = pf.find(text, 0); i < text.size(); i = pf.find(text, i + 1), candidates++)
+			starts.erase(i);
+		REQUIRE(starts.empty());
+		REQUIRE(candidates < text.size() / 4);
+
+		ac.prefilter(false);
+		REQUIRE_FALSE(ac.prefilter());
+		REQUIRE(collect(ac, text) == expected);
+	}
+
+	GIVEN("a key split by the end of a chunk") {
+		store tt;
+		tt.insert("xyz", 1);
+		matcher const ac(tt);
+		REQUIRE(ac.prefilter());
+		auto st = ac.make_stream();
+		int n{0};
+		auto count = [&n](auto const &) { n++; };
+		st.feed("....x", count);
+		st.feed("yz..xy", count);
+		st.feed("z", count);
+		REQUIRE(n == 2);
+	}
+}
@@ -0,0 +1,443 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-keygen.hh"
+
+#include "x-bench.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <cctype>
+
+// The benchmark suite: trie_t against std::map, std::unordered_map
+// and a sorted vector, on several datasets and sizes. Each operation
+// reports ns/op, allocs/op and B/op, as CSV (the default), JSON or
+// aligned text, to be kept and compared between changes.
+//
+// Run this:
+//
+//    ./bin/test-trie-bench [--sizes 1000,10000,100000,1000000]
+//                          [--datasets config,url,words,uuid]
+//                          [--format csv|json|text] [--zipf 0.99]
+//                          [--words /usr/share/dict/words]
+//                          [--queries 1000000] [--perf on]
+//
+// The datasets, all made from a fixed seed:
+//
+//    config  dotted config keys, 2 to 5 segments from a vocabulary
+//    url     REST paths with versions, resources and numeric ids
+//    words   English-like words made of syllables, or the lines of
+//            the --words file
+//    uuid    random UUIDs, no shared prefixes beyond a few bytes
+//    synthetic  a trie::keygen shape, 2 to 5 segments with fan-outs
+//            8, 32, 64 (not in the default list)
+//
+// The lookups run twice: with uniform access over the keys, and with
+// Zipf-skewed access (the "_zipf" ops), which keeps the hot keys in
+// the caches as a production workload does. The lookups are repeated
+// up to --queries, so that small sizes are timed long enough.
+//
+// --perf on (or TRIE_BENCH_PERF=1) adds the hardware counters per op,
+// cycles, instructions, L1d/LLC/dTLB misses and branch misses, where
+// perf_event_open(2) is permitted; see x-perf.hh.
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+
+	struct options {
+		std::vector<std::size_t> sizes{1000, 10000, 100000, 1000000};
+		std::vector<std::string> datasets{"config", "url", "words", "uuid"};
+		std::string format{"csv"};
+		std::string words_file{};
+		double zipf{0.99};
+		std::size_t queries{1000000};
+	};
+
+	// datasets
+
+	inline auto config_key(std::mt19937_64 &rng) -> std::string {
+		static char const *words[] = {
+		        "app", "server", "client", "logging", "cache", "db", "auth", "mq", "metrics", "ui",
+		        "http", "grpc", "tls", "timeout", "retry", "pool", "size", "level", "file", "rotate",
+		        "host", "port", "user", "password", "enabled", "interval", "backoff", "max", "min", "limit",
+		        "queue", "topic", "consumer", "producer", "shard", "replica", "region", "zone", "cluster", "node"};
+		constexpr std::size_t n = sizeof(words) / sizeof(words[0]);
+		std::string key{words[rng() % 10]};
+		for (auto depth = 1 + rng() % 4; depth > 0; depth--) {
+			key += '.';
+			key += words[rng() % n];
+			if (rng() % 3 == 0) key += std::to_string(rng() % 64);
+		}
+		return key;
+	}
+
+	inline auto url_key(std::mt19937_64 &rng) -> std::string {
+		static char const *resources[] = {"users", "orders", "items", "carts", "invoices", "sessions", "files", "reports"};
+		std::string key{"/api/v"};
+		key += std::to_string(1 + rng() % 3);
+		key += '/';
+		key += resources[rng() % 8];
+		key += '/';
+		key += std::to_string(rng() % 1000000);
+		if (rng() % 2) {
+			key += '/';
+			key += resources[rng() % 8];
+			key += '/';
+			key += std::to_string(rng() % 1000);
+		}
+		return key;
+	}
+
+	inline auto word_key(std::mt19937_64 &rng) -> std::string {
+		static char const *onsets[] = {"b", "c", "d", "f", "g", "h", "l", "m", "n", "p", "r", "s", "t", "v", "w",
+		                               "br", "cl", "dr", "fl", "gr", "pl", "pr", "sh", "st", "th", "tr", "ch", ""};
+		static char const *vowels[] = {"a", "e", "i", "o", "u", "ea", "ai", "ou", "ee", "oo"};
+		static char const *suffixes[] = {"", "", "", "s", "ed", "ing", "er", "ly", "ness", "tion"};
+		std::string key;
+		for (auto syllables = 1 + rng() % 4; syllables > 0; syllables--) {
+			key += onsets[rng() % (sizeof(onsets) / sizeof(onsets[0]))];
+			key += vowels[rng() % (sizeof(vowels) / sizeof(vowels[0]))];
+		}
+		key += suffixes[rng() % (sizeof(suffixes) / sizeof(suffixes[0]))];
+		return key;
+	}
+
+	inline auto uuid_key(std::mt19937_64 &rng) -> std::string {
+		static char const hex[] = "0123456789abcdef";
+		std::string key(36, '-');
+		auto a = rng(), b = rng();
+		for (std::size_t i = 0, bit = 0; i < 36; i++) {
+			if (i == 8 || i == 13 || i == 18 || i == 23) continue;
+			auto &w = bit < 64 ? a : b;
+			key[i] = hex[(w >> (bit % 64)) & 0xf];
+			bit += 4;
+		}
+		return key;
+	}
+
+	// count distinct keys of a dataset, in a random order
+	inline auto make_dataset(std::string const &name, std::size_t count, options const &opt) -> std::vector<std::string> {
+		std::vector<std::string> keys;
+		std::unordered_set<std::string> seen;
+		keys.reserve(count);
+		seen.reserve(count);
+		auto add = [&](std::string k) {
+			if (!k.empty() && seen.insert(k).second) keys.push_back(std::move(k));
+		};
+
+		if (name == "words" && !opt.words_file.empty()) {
+			std::ifstream ifs(opt.words_file);
+			for (std::string line; keys.size() < count && std::getline(ifs, line);) add(line);
+			std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+			return keys;
+		}
+		if (name == "synthetic") {
+			trie::keygen::shape sh;
+			sh.count = count;
+			sh.fanout = {8, 32, 64, 64};
+			sh.seed = count;
+			keys = trie::keygen::make_keys(sh);
+			std::shuffle(keys.begin(), keys.end(), std::mt19937_64(count));
+			return keys;
+		}
+
+		std::mt19937_64 rng(count * 31 + name.size());
+		auto gen = name == "url" ? url_key : name == "words" ? word_key : name == "uuid" ? uuid_key : config_key;
+		// a saturated generator gives up after many duplicates in a row
+		for (std::size_t misses = 0; keys.size() < count && misses < count * 8 + 1000;) {
+			auto const before = keys.size();
+			add(gen(rng));
+			misses = keys.size() == before ? misses + 1 : 0;
+		}
+		return keys;
+	}
+
+	// reporting
+
+	struct record {
+		std::string dataset;
+		std::size_t size;
+		std::string container;
+		trie::bench::result_s r;
+	};
+
+	// "L1d-misses" -> "l1d_misses_per_op", a CSV column or JSON field
+	inline auto hw_column(std::size_t i) -> std::string {
+		std::string name{trie::bench::hw_event_names[i]};
+		for (auto &c : name) c = c == '-' ? '_' : char(std::tolower(static_cast<unsigned char>(c)));
+		return name + "_per_op";
+	}
+
+	class reporter {
+	public:
+		explicit reporter(std::string format)
+		    : _format(std::move(format))
+		    , _hw(trie::bench::hw_counters_wanted()) {
+			if (_format == "csv") {
+				std::cout << "dataset,size,container,op,ops,ns_per_op,allocs_per_op,bytes_per_op";
+				// the counters which could not be read stay empty
+				for (std::size_t i = 0; _hw && i < trie::bench::hw_event_count; i++) std::cout << ',' << hw_column(i);
+				std::cout << '\n';
+			} else if (_format == "json") {
+				std::cout << "[";
+			}
+		}
+		~reporter() {
+			if (_format == "json") std::cout << (_first ? "]" : "\n]") << '\n';
+		}
+
+		auto add(record const &rec) -> void {
+			auto const &r = rec.r;
+			if (_format == "csv") {
+				std::cout << rec.dataset << ',' << rec.size << ',' << rec.container << ',' << r.name << ',' << r.ops
+				          << ',' << r.ns_per_op << ',' << r.allocs_per_op << ',' << r.bytes_per_op;
+				for (std::size_t i = 0; _hw && i < trie::bench::hw_event_count; i++) {
+					std::cout << ',';
+					if (r.hw.has(trie::bench::hw_event(i))) std::cout << r.hw.values[i];
+				}
+				std::cout << '\n';
+			} else if (_format == "json") {
+				std::cout << (_first ? "\n" : ",\n")
+				          << R"(  {"dataset":")" << rec.dataset << R"(","size":)" << rec.size
+				          << R"(,"container":")" << rec.container << R"(","op":")" << r.name
+				          << R"(","ops":)" << r.ops << R"(,"ns_per_op":)" << r.ns_per_op
+				          << R"(,"allocs_per_op":)" << r.allocs_per_op << R"(,"bytes_per_op":)" << r.bytes_per_op;
+				for (std::size_t i = 0; i < trie::bench::hw_event_count; i++)
+					if (r.hw.has(trie::bench::hw_event(i))) std::cout << ",\"" << hw_column(i) << "\":" << r.hw.values[i];
+				std::cout << "}";
+			} else {
+				std::cout << std::left << std::setw(8) << rec.dataset << std::right << std::setw(10) << rec.size << "  "
+				          << std::left << std::setw(16) << rec.container << std::right << r << '\n';
+			}
+			std::cout.flush();
+			_first = false;
+		}
+
+	private:
+		std::string _format;
+		bool _hw;
+		bool _first{true};
+	};
+
+	// keeps the results of the lookups alive
+	inline std::size_t sink{};
+
+	struct workload {
+		std::string dataset;
+		std::vector<std::string> keys;         // in insertion order
+		std::vector<std::string const *> uniform; // lookup traces
+		std::vector<std::string const *> skewed;
+	};
+
+	inline auto make_workload(std::string const &dataset, std::size_t size, options const &opt) -> workload {
+		workload w{dataset, make_dataset(dataset, size, opt), {}, {}};
+		auto const n = w.keys.size();
+		if (n == 0) return w;
+		auto const queries = std::max(n, opt.queries);
+		std::mt19937_64 rng(size);
+		w.uniform.reserve(queries);
+		for (std::size_t i = 0; i < queries; i++) w.uniform.push_back(&w.keys[i % n]);
+		std::shuffle(w.uniform.begin(), w.uniform.end(), rng);
+		// the hot ranks fall on random keys
+		std::vector<std::size_t> rank(n);
+		for (std::size_t i = 0; i < n; i++) rank[i] = i;
+		std::shuffle(rank.begin(), rank.end(), rng);
+		trie::keygen::zipf const zipf(n, opt.zipf);
+		w.skewed.reserve(queries);
+		for (std::size_t i = 0; i < queries; i++) w.skewed.push_back(&w.keys[rank[zipf(rng)]]);
+		return w;
+	}
+
+	// the containers
+
+	inline auto bench_trie(workload const &w, reporter &out) -> void {
+		auto const n = w.keys.size();
+		auto report = [&](trie::bench::result_s r) { out.add({w.dataset, n, "trie_t", std::move(r)}); };
+		auto lookups = [&](char const *name, auto const &trace, auto &&fn) {
+			report(trie::bench::measure(name, trace.size(), [&] {
+				for (auto const *k : trace) sink += fn(*k);
+			}));
+		};
+
+		store tt;
+		report(trie::bench::measure("insert", n, [&] {
+			int i{0};
+			for (auto const &k : w.keys) tt.insert(k.c_str(), i++);
+		}));
+		report(trie::bench::measure("set", n, [&] {
+			for (auto const &k : w.keys) tt.set(k.c_str(), 1);
+		}));
+
+		auto const &ct = tt;
+		lookups("get", w.uniform, [&ct](std::string const &k) { return std::size_t(ct.get<int>(k.c_str())); });
+		lookups("get_zipf", w.skewed, [&ct](std::string const &k) { return std::size_t(ct.get<int>(k.c_str())); });
+		lookups("fast_find", w.uniform, [&ct](std::string const &k) { return std::size_t(ct.fast_find(k.c_str()).matched); });
+		lookups("fast_find_zipf", w.skewed, [&ct](std::string const &k) { return std::size_t(ct.fast_find(k.c_str()).matched); });
+		lookups("locate", w.uniform, [&tt](std::string const &k) { return std::size_t(tt.locate(k.c_str()).matched); });
+		lookups("search", w.uniform, [&tt](std::string const &k) { return std::size_t(tt.search(k.c_str()).matched); });
+		lookups("size", w.uniform, [&ct](std::string const &) { return ct.size(); });
+
+		report(trie::bench::measure("walk", n, [&] {
+			ct.walk([](store::node_t const &nd, int, int) {
+				if (nd.type() == store::node_t::NODE_LEAF) sink++;
+			});
+		}));
+		report(trie::bench::measure("remove", n, [&] {
+			for (auto const &k : w.keys) sink += tt.remove(k.c_str()).ok;
+		}));
+	}
+
+	template<typename Map>
+	auto bench_map(char const *container, workload const &w, reporter &out) -> void {
+		auto const n = w.keys.size();
+		auto report = [&](trie::bench::result_s r) { out.add({w.dataset, n, container, std::move(r)}); };
+		Map m;
+		auto lookups = [&](char const *name, auto const &trace) {
+			report(trie::bench::measure(name, trace.size(), [&] {
+				for (auto const *k : trace) sink += std::size_t(m.find(*k)->second);
+			}));
+		};
+
+		report(trie::bench::measure("insert", n, [&] {
+			int i{0};
+			for (auto const &k : w.keys) m.emplace(k, i++);
+		}));
+		report(trie::bench::measure("set", n, [&] {
+			for (auto const &k : w.keys) m[k] = 1;
+		}));
+		lookups("get", w.uniform);
+		lookups("get_zipf", w.skewed);
+		report(trie::bench::measure("size", w.uniform.size(), [&] {
+			for (std::size_t i = 0; i < w.uniform.size(); i++) sink += m.size();
+		}));
+		report(trie::bench::measure("walk", n, [&] {
+			for (auto const &[k, v] : m) sink += std::size_t(v);
+		}));
+		report(trie::bench::measure("remove", n, [&] {
+			for (auto const &k : w.keys) sink += m.erase(k);
+		}));
+	}
+
+	// a sorted vector is built in one go and searched by bisection, it
+	// has no incremental insert or remove worth measuring.
+	inline auto bench_sorted_vector(workload const &w, reporter &out) -> void {
+		auto const n = w.keys.size();
+		auto report = [&](trie::bench::result_s r) { out.add({w.dataset, n, "sorted_vector", std::move(r)}); };
+		using entry = std::pair<std::string, int>;
+		std::vector<entry> v;
+		report(trie::bench::measure("insert", n, [&] {
+			int i{0};
+			v.reserve(n);
+			for (auto const &k : w.keys) v.emplace_back(k, i++);
+			std::sort(v.begin(), v.end());
+		}));
+		auto find = [&v](std::string const &k) -> int & {
+			return std::lower_bound(v.begin(), v.end(), k, [](entry const &e, std::string const &key) { return e.first < key; })->second;
+		};
+		report(trie::bench::measure("set", n, [&] {
+			for (auto const &k : w.keys) find(k) = 1;
+		}));
+		for (auto const *name : {"get", "get_zipf"}) {
+			auto const &trace = std::string_view{name} == "get" ? w.uniform : w.skewed;
+			report(trie::bench::measure(name, trace.size(), [&] {
+				for (auto const *k : trace) sink += std::size_t(find(*k));
+			}));
+		}
+		report(trie::bench::measure("walk", n, [&] {
+			for (auto const &[k, val] : v) sink += std::size_t(val);
+		}));
+	}
+
+	inline auto split(std::string const &s) -> std::vector<std::string> {
+		std::vector<std::string> ret;
+		for (std::size_t pos = 0; pos <= s.size();) {
+			auto end = s.find(',', pos);
+			if (end == std::string::npos) end = s.size();
+			if (end > pos) ret.push_back(s.substr(pos, end - pos));
+			pos = end + 1;
+		}
+		return ret;
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	using namespace trie::tests;
+	options opt;
+	for (int i = 1; i < argc; i += 2) {
+		std::string const flag{argv[i]};
+		if (i + 1 == argc) {
+			std::cerr << "unknown option " << flag << " without a value\n";
+			return 1;
+		}
+		std::string const value{argv[i + 1]};
+		if (flag == "--sizes") {
+			opt.sizes.clear();
+			for (auto const &s : split(value)) opt.sizes.push_back(std::size_t(std::max(1LL, std::atoll(s.c_str()))));
+		} else if (flag == "--datasets") {
+			opt.datasets = split(value);
+		} else if (flag == "--format" && (value == "csv" || value == "json" || value == "text")) {
+			opt.format = value;
+		} else if (flag == "--zipf") {
+			opt.zipf = std::atof(value.c_str());
+		} else if (flag == "--words") {
+			opt.words_file = value;
+		} else if (flag == "--perf") {
+			trie::bench::use_hw_counters(value != "0" && value != "off");
+		} else if (flag == "--queries") {
+			opt.queries = std::size_t(std::max(1LL, std::atoll(value.c_str())));
+		} else {
+			std::cerr << "unknown option " << flag << ' ' << value << '\n';
+			return 1;
+		}
+	}
+
+	for (auto const &dataset : opt.datasets) {
+		if (dataset != "config" && dataset != "url" && dataset != "words" && dataset != "uuid" && dataset != "synthetic") {
+			std::cerr << "unknown dataset " << dataset << '\n';
+			return 1;
+		}
+	}
+	if (!opt.words_file.empty() && !std::ifstream(opt.words_file)) {
+		std::cerr << "cannot open " << opt.words_file << '\n';
+		return 1;
+	}
+
+	if (trie::bench::hw_counters_wanted()) {
+		auto const &hc = trie::bench::thread_hw_counters();
+		if (!hc.error().empty())
+			std::cerr << "trie-bench: " << (hc.available() ? "some hardware counters are left out, " : "no hardware counters, ")
+			          << hc.error() << '\n';
+	}
+
+	reporter out(opt.format);
+	for (auto const &dataset : opt.datasets) {
+		for (auto size : opt.sizes) {
+			auto const w = make_workload(dataset, size, opt);
+			if (w.keys.empty()) continue;
+			bench_trie(w, out);
+			bench_map<std::map<std::string, int>>("std::map", w, out);
+			bench_map<std::unordered_map<std::string, int>>("unordered_map", w, out);
+			bench_sorted_vector(w, out);
+		}
+	}
+	if (opt.format != "json") std::cerr << "(sink: " << sink << ")" << '\n';
+	return 0;
+}
@@ -0,0 +1,152 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-keygen.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	inline auto segments(std::string const &key, char delimiter = '.') -> std::vector<std::string> {
+		std::vector<std::string> ret;
+		for (std::size_t pos = 0;;) {
+			auto const end = key.find(delimiter, pos);
+			ret.push_back(key.substr(pos, end == std::string::npos ? std::string::npos : end - pos));
+			if (end == std::string::npos) return ret;
+			pos = end + 1;
+		}
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/keygen: key sets of a shape", "[trie][keygen]") {
+	using namespace trie::tests;
+	trie::keygen::shape sh;
+	sh.count = 20000;
+	sh.min_depth = 2;
+	sh.max_depth = 4;
+	sh.fanout = {6, 20, 40};
+	sh.min_segment = 4;
+	sh.max_segment = 8;
+	sh.seed = 42;
+	auto const keys = trie::keygen::make_keys(sh);
+
+	GIVEN("the parameters") {
+		REQUIRE(keys.size() == sh.count);
+		REQUIRE(std::set<std::string>(keys.begin(), keys.end()).size() == keys.size());
+		std::set<std::string> roots;
+		std::map<std::string, std::set<std::string>> children; // of the first segments
+		for (auto const &k : keys) {
+			auto const segs = segments(k);
+			REQUIRE((segs.size() >= 2 && segs.size() <= 4));
+			for (auto const &s : segs) REQUIRE((s.size() >= 4 && s.size() <= 8));
+			roots.insert(segs[0]);
+			children[segs[0]].insert(segs[1]);
+		}
+		REQUIRE(roots.size() <= 6);
+		for (auto const &[root, chs] : children) REQUIRE(chs.size() <= 20);
+	}
+
+	GIVEN("the same seed, the same keys") {
+		REQUIRE(trie::keygen::make_keys(sh) == keys);
+		sh.seed = 43;
+		REQUIRE(trie::keygen::make_keys(sh) != keys);
+	}
+
+	GIVEN("the same keys with any standard library") {
+		trie::keygen::shape small;
+		small.count = 4;
+		small.seed = 7;
+		REQUIRE(trie::keygen::make_keys(small) == std::vector<std::string>{"qjxjbaxhcr.fac.jge.jxq.isdxokba", "qcxhqu.ekhbol.isestx",
+		                                                                     "qcxhqu.vcoy.hsitu", "bpvujqthjo.nisugl.qudvdhhzmd"});
+	}
+
+	GIVEN("more shared prefixes between neighbours") {
+		auto common = [](std::vector<std::string> const &ks) {
+			std::size_t total{};
+			for (std::size_t i = 1; i < ks.size(); i++) {
+				auto const &a = ks[i - 1], &b = ks[i];
+				std::size_t n{};
+				while (n < a.size() && n < b.size() && a[n] == b[n]) n++;
+				total += n;
+			}
+			return total;
+		};
+		sh.shared_prefix = 0;
+		auto const scattered = common(trie::keygen::make_keys(sh));
+		sh.shared_prefix = 0.9;
+		REQUIRE(common(trie::keygen::make_keys(sh)) > scattered * 2);
+	}
+
+	GIVEN("a shape too small for the count") {
+		sh.fanout = {2};
+		sh.max_depth = 3;
+		auto const few = trie::keygen::make_keys(sh);
+		REQUIRE(few.size() == 2 * 2 + 2 * 2 * 2); // the keys of depth 2 and 3
+	}
+
+	GIVEN("geometric segment lengths") {
+		sh.lengths = trie::keygen::length_dist::geometric;
+		std::size_t shortest{};
+		for (auto const &k : trie::keygen::make_keys(sh))
+			for (auto const &s : segments(k)) shortest += s.size() == 4;
+		REQUIRE(shortest > 0);
+	}
+}
+
+SCENARIO("trie/keygen: query traces", "[trie][keygen]") {
+	using namespace trie::tests;
+	trie::keygen::shape sh;
+	sh.count = 5000;
+	auto const keys = trie::keygen::make_keys(sh);
+	trie::trie_t<trie::value_t> tt;
+	for (auto const &k : keys) tt.insert(k.c_str(), 1);
+
+	trie::keygen::trace_options opt;
+	opt.count = 20000;
+	opt.hit_ratio = 0.75;
+	auto const trace = trie::keygen::make_trace(keys, opt);
+	REQUIRE(trace.size() == opt.count);
+
+	std::size_t hits{};
+	std::map<std::string, std::size_t> popularity;
+	for (auto const &q : trace) {
+		REQUIRE(std::as_const(tt).fast_find(q.key.c_str()).matched == q.hit);
+		if (q.hit) {
+			hits++;
+			popularity[q.key]++;
+		}
+	}
+	REQUIRE((hits > 14500 && hits < 15500));
+	// skewed: the most popular key is asked far more than the average
+	std::size_t top{};
+	for (auto const &[k, n] : popularity) top = std::max(top, n);
+	REQUIRE(top > 20 * hits / keys.size());
+	REQUIRE(trie::keygen::make_trace(keys, opt)[123].key == trace[123].key);
+
+	GIVEN("the same trace with any standard library") {
+		sh.count = 100;
+		sh.seed = 7;
+		opt.count = 2;
+		opt.hit_ratio = 0.5;
+		opt.seed = 7;
+		auto const few = trie::keygen::make_trace(trie::keygen::make_keys(sh), opt);
+		REQUIRE(few[0].key == "bpvujqthjo.ouys.rzzyv.rmkxxmz.lthe");
+		REQUIRE(few[0].hit);
+		REQUIRE(few[1].key == "bpvujqthjo.ouys.rzzyv.rmkxxmz.a556");
+		REQUIRE_FALSE(few[1].hit);
+	}
+}
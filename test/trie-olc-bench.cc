@@ -0,0 +1,162 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-olc.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Contention benchmark of olc_trie_t against a trie_t guarded by one
+// global reader/writer lock.
+//
+// Run this:
+//
+//    ./bin/test-trie-olc-bench [threads] [write-ratio] [zipf-skew] [keys] [ops-per-thread]
+//
+// For example, 8 threads, 20% writes, zipf skew 0.99:
+//
+//    ./bin/test-trie-olc-bench 8 0.2 0.99
+//
+// A skew of 0 means uniform access. Larger skews concentrate the
+// accesses on fewer keys, and so on fewer nodes.
+
+namespace trie::tests {
+	struct bench_options {
+		int threads{4};
+		double write_ratio{0.2};
+		double skew{0.99};
+		int keys{100000};
+		int ops{200000}; // per thread
+	};
+
+	/**
+	 * @brief zipf_sampler draws an index in [0, n) with probability
+	 * proportional to 1/(i+1)^s.
+	 */
+	class zipf_sampler {
+	public:
+		zipf_sampler(std::size_t n, double s)
+		    : _cdf(n) {
+			double sum{0};
+			for (std::size_t i = 0; i < n; i++) {
+				sum += 1.0 / std::pow(double(i + 1), s);
+				_cdf[i] = sum;
+			}
+			for (auto &c : _cdf) c /= sum;
+		}
+		template<typename Rng>
+		auto operator()(Rng &rng) const -> std::size_t {
+			auto const u = std::uniform_real_distribution<double>(0, 1)(rng);
+			auto it = std::lower_bound(_cdf.begin(), _cdf.end(), u);
+			return std::min<std::size_t>(std::size_t(it - _cdf.begin()), _cdf.size() - 1);
+		}
+
+	private:
+		std::vector<double> _cdf;
+	};
+
+	inline auto make_keys(int count) -> std::vector<std::string> {
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics", "ui"};
+		std::vector<std::string> keys;
+		keys.reserve(std::size_t(count));
+		for (int i = 0; i < count; i++) {
+			keys.push_back(std::string("app.") + sections[i % 8] + ".k" + std::to_string(i / 8));
+		}
+		// hot keys shall not be clustered in one section
+		std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+		return keys;
+	}
+
+	template<typename Insert, typename Find>
+	void run_contention(char const *title, bench_options const &opt, std::vector<std::string> const &keys,
+	                    Insert &&insert, Find &&find) {
+		zipf_sampler const zipf(keys.size(), opt.skew);
+		std::atomic<long> hits{0};
+		std::vector<std::thread> threads;
+		auto const total_ops = double(opt.threads) * opt.ops;
+
+		trie::chrono::timer tr([title, &opt, &hits, total_ops](auto duration) -> bool {
+			auto const dur = duration * 1000 * 1000;
+			std::cout << title << ": threads=" << opt.threads << " writes=" << opt.write_ratio
+			          << " skew=" << opt.skew << " -> " << (dur / total_ops) << "ns/op, "
+			          << (total_ops / duration / 1000.0) << " Mops/s (hits: " << hits.load() << ")" << '\n';
+			return false;
+		});
+
+		for (int t = 0; t < opt.threads; t++) {
+			threads.emplace_back([&, t] {
+				std::mt19937_64 rng(std::uint64_t(t) + 7);
+				std::uniform_real_distribution<double> coin(0, 1);
+				long local_hits{0};
+				for (int i = 0; i < opt.ops; i++) {
+					auto const &key = keys[zipf(rng)];
+					if (coin(rng) < opt.write_ratio) {
+						insert(key, i);
+					} else if (find(key)) {
+						local_hits++;
+					}
+				}
+				hits += local_hits;
+			});
+		}
+		for (auto &th : threads) th.join();
+	}
+
+	void bench_olc_contention(bench_options const &opt) {
+		auto const keys = make_keys(opt.keys);
+
+		{
+			trie::olc_trie_t<trie::value_t> tt;
+			for (std::size_t i = 0; i < keys.size(); i += 2) tt.insert(keys[i], int(i));
+			run_contention(
+			        "olc_trie_t", opt, keys,
+			        [&tt](std::string const &key, int v) { tt.insert(key, v); },
+			        [&tt](std::string const &key) { return tt.has(key); });
+		}
+
+		{
+			trie::trie_t<trie::value_t> tt;
+			std::shared_mutex mu;
+			for (std::size_t i = 0; i < keys.size(); i += 2) tt.insert(keys[i].c_str(), int(i));
+			run_contention(
+			        "trie_t+rwlock", opt, keys,
+			        [&tt, &mu](std::string const &key, int v) {
+				        std::unique_lock lock(mu);
+				        tt.insert(key.c_str(), int(v));
+			        },
+			        [&tt, &mu](std::string const &key) {
+				        std::shared_lock lock(mu);
+				        return tt.has(key.c_str());
+			        });
+		}
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	trie::tests::bench_options opt;
+	if (argc > 1) opt.threads = std::max(1, std::atoi(argv[1]));
+	if (argc > 2) opt.write_ratio = std::atof(argv[2]);
+	if (argc > 3) opt.skew = std::atof(argv[3]);
+	if (argc > 4) opt.keys = std::max(1, std::atoi(argv[4]));
+	if (argc > 5) opt.ops = std::max(1, std::atoi(argv[5]));
+
+	trie::tests::bench_olc_contention(opt);
+	return 0;
+}
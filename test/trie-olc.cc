@@ -0,0 +1,171 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "trie-cxx/trie-olc.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using olc_store = trie::olc_trie_t<trie::value_t>;
+
+	inline void build_minimal_olc_trie(olc_store &tt) {
+		tt.insert("app.debug", true);
+		tt.insert("app.verbose", true);
+		tt.insert("app.dump", 3);
+		tt.insert("app.logging.file", "~/.trie.log");
+		tt.insert("app.server.start", 5);
+		tt.insert("app.logging.rotate", 6);
+		tt.insert("app.logging.words", std::vector<std::string>{"a", "1", "false"});
+		tt.insert("app.server.sites", 1);
+	}
+
+	// the count of nodes but the root, a compact tree has the same
+	// shape as a fresh one with the same keys.
+	inline auto count_nodes(olc_store::node_t const &nd) -> std::size_t {
+		std::size_t n{0};
+		if (auto children = nd.children()) {
+			for (auto const &ch : *children) n += 1 + count_nodes(*ch);
+		}
+		return n;
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/olc: single writer", "[trie][olc]") {
+	using namespace trie::tests;
+	olc_store tt;
+	build_minimal_olc_trie(tt);
+
+	REQUIRE(tt.size() == 8);
+	REQUIRE(tt.has("app.server.start"));
+	REQUIRE(tt.has("app.server.sites"));
+	REQUIRE_FALSE(tt.has("app.server.s"));
+	REQUIRE_FALSE(tt.has("app.server"));
+	REQUIRE(std::get<int>(*tt.find("app.dump")) == 3);
+
+	GIVEN("a key which ends inside a fragment") {
+		tt.insert("app.server.s", 7);
+		REQUIRE(std::get<int>(*tt.find("app.server.s")) == 7);
+		REQUIRE(std::get<int>(*tt.find("app.server.start")) == 5);
+		REQUIRE(tt.size() == 9);
+	}
+
+	GIVEN("update and remove") {
+		auto old = tt.insert("app.dump", 4);
+		REQUIRE(old);
+		REQUIRE(std::get<int>(*old) == 3);
+		REQUIRE(std::get<int>(*tt.find("app.dump")) == 4);
+
+		auto removed = tt.remove("app.logging.file");
+		REQUIRE(removed);
+		REQUIRE_FALSE(tt.has("app.logging.file"));
+		REQUIRE(tt.has("app.logging.rotate"));
+		REQUIRE_FALSE(tt.remove("app.logging.file"));
+		REQUIRE(tt.size() == 7);
+	}
+
+	GIVEN("removes which leave the tree compact") {
+		tt.insert("app.server.s", 7);
+		for (auto const *key : {"app.server.s", "app.logging.rotate", "app.debug", "app.server.sites"}) {
+			REQUIRE(tt.remove(key));
+			olc_store fresh;
+			tt.walk([&fresh](std::string const &k, trie::value_t const &val) { fresh.insert(k, val); });
+			REQUIRE(count_nodes(tt.root()) == count_nodes(fresh.root()));
+		}
+		for (auto const *key : {"app.verbose", "app.dump", "app.logging.file", "app.server.start", "app.logging.words"})
+			REQUIRE(tt.remove(key));
+		REQUIRE(tt.size() == 0);
+		REQUIRE(count_nodes(tt.root()) == 0);
+	}
+
+	GIVEN("walk in byte order") {
+		std::vector<std::string> keys;
+		tt.walk([&keys](std::string const &key, trie::value_t const &) { keys.push_back(key); });
+		REQUIRE(keys.size() == 8);
+		REQUIRE(std::is_sorted(keys.begin(), keys.end()));
+	}
+}
+
+SCENARIO("trie/olc: concurrent writers on disjoint ranges", "[trie][olc][concurrent]") {
+	using namespace trie::tests;
+	olc_store tt;
+	build_minimal_olc_trie(tt);
+
+	constexpr int writers = 4;
+	constexpr int keys_per_writer = 2000;
+	char const *sections[writers] = {"app.server.", "app.logging.", "app.cache.", "app.db."};
+
+	std::atomic<int> missed{0};
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++) {
+		threads.emplace_back([&tt, &sections, w] {
+			for (int i = 0; i < keys_per_writer; i++) {
+				tt.insert(std::string(sections[w]) + "k" + std::to_string(i), i);
+			}
+		});
+	}
+	// a reader which runs along with the writers
+	threads.emplace_back([&tt, &missed] {
+		for (int i = 0; i < 20000; i++) {
+			if (!tt.find("app.dump")) missed++;
+		}
+	});
+	for (auto &t : threads) t.join();
+
+	REQUIRE(missed == 0);
+	REQUIRE(tt.size() == 8 + writers * keys_per_writer);
+	for (int w = 0; w < writers; w++) {
+		for (int i = 0; i < keys_per_writer; i++) {
+			auto v = tt.find(std::string(sections[w]) + "k" + std::to_string(i));
+			REQUIRE(v);
+			REQUIRE(std::get<int>(*v) == i);
+		}
+	}
+	REQUIRE(std::get<int>(*tt.find("app.server.start")) == 5);
+}
+
+SCENARIO("trie/olc: concurrent insert and remove churn", "[trie][olc][concurrent]") {
+	using namespace trie::tests;
+	olc_store tt;
+	build_minimal_olc_trie(tt);
+	auto const base = count_nodes(tt.root());
+
+	constexpr int writers = 4;
+	std::atomic<int> missed{0};
+	std::vector<std::thread> threads;
+	for (int w = 0; w < writers; w++) {
+		threads.emplace_back([&tt, w] {
+			// the writers share the keys, so that they split and merge
+			// the same nodes
+			for (int round = 0; round < 50; round++) {
+				for (int i = 0; i < 200; i++) tt.insert("app.server.k" + std::to_string((i * 7 + w) % 200), i);
+				for (int i = 0; i < 200; i++) tt.remove("app.server.k" + std::to_string((i * 11 + w) % 200));
+			}
+		});
+	}
+	threads.emplace_back([&tt, &missed] {
+		for (int i = 0; i < 20000; i++) {
+			if (!tt.find("app.server.start")) missed++;
+		}
+	});
+	for (auto &t : threads) t.join();
+
+	REQUIRE(missed == 0);
+	for (int i = 0; i < 200; i++) tt.remove("app.server.k" + std::to_string(i));
+	REQUIRE(tt.size() == 8);
+	REQUIRE(count_nodes(tt.root()) == base);
+}
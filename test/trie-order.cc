@@ -0,0 +1,341 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <ranges>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-frontcode.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+
+	// random dotted keys over a small alphabet, so that there are
+	// many shared prefixes, keys being prefixes of other keys, and
+	// splits at every depth.
+	inline auto build_random_keys(store &tt, std::set<std::string> &keys, int count, unsigned seed) -> void {
+		std::mt19937 rng(seed);
+		char const alphabet[] = "ab.zA~";
+		for (int i = 0; i < count; i++) {
+			std::string key{"k"};
+			for (auto len = 1 + rng() % 7; len > 0; len--) key += alphabet[rng() % (sizeof(alphabet) - 1)];
+			tt.insert(key.c_str(), int(i));
+			keys.insert(key);
+		}
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/order: rank, select and split_ranges", "[trie][order]") {
+	using namespace trie::tests;
+	store tt;
+	std::set<std::string> keys;
+	build_random_keys(tt, keys, 3000, 7);
+	REQUIRE(tt.size() == keys.size());
+
+	GIVEN("select returns the keys in byte order") {
+		std::size_t i{0};
+		for (auto const &key : keys) {
+			auto nd = tt.select(i++);
+			REQUIRE(nd);
+			REQUIRE(nd->path() == key);
+		}
+		REQUIRE_FALSE(tt.select(keys.size()));
+		REQUIRE_FALSE(tt.nth_key(keys.size()));
+		REQUIRE(tt.nth_key(0) == *keys.begin());
+	}
+
+	GIVEN("rank counts the keys less than any key") {
+		for (auto const &key : keys) {
+			auto const expected = std::size_t(std::distance(keys.begin(), keys.find(key)));
+			REQUIRE(tt.rank(key.c_str()) == expected);
+		}
+		std::mt19937 rng(11);
+		char const alphabet[] = "ab.zA~\x7f";
+		for (int i = 0; i < 2000; i++) {
+			std::string probe{i % 10 == 0 ? "" : "k"};
+			for (auto len = rng() % 9; len > 0; len--) probe += alphabet[rng() % (sizeof(alphabet) - 1)];
+			auto const expected = std::size_t(std::distance(keys.begin(), keys.lower_bound(probe)));
+			REQUIRE(tt.rank(probe.c_str()) == expected);
+		}
+	}
+
+	GIVEN("split_ranges partitions the keys evenly") {
+		for (std::size_t k : {1u, 3u, 8u, 64u}) {
+			auto ranges = tt.split_ranges(k);
+			REQUIRE(ranges.size() == k);
+			std::size_t next{0};
+			for (auto const &r : ranges) {
+				REQUIRE(r.offset == next);
+				REQUIRE(r.count + 1 >= keys.size() / k);
+				REQUIRE(r.count <= keys.size() / k + 1);
+				REQUIRE(tt.rank(r.first.c_str()) == r.offset);
+				REQUIRE(tt.rank(r.last.c_str()) == r.offset + r.count - 1);
+				next += r.count;
+			}
+			REQUIRE(next == keys.size());
+		}
+		REQUIRE(tt.split_ranges(0).empty());
+		REQUIRE(store{}.split_ranges(4).empty());
+	}
+}
+
+SCENARIO("trie/order: sorted children and ordered iterators", "[trie][order][iterator]") {
+	using namespace trie::tests;
+	store tt;
+	std::set<std::string> keys;
+	build_random_keys(tt, keys, 3000, 5);
+
+	GIVEN("walk visits the keys in byte order") {
+		std::vector<std::string> walked;
+		tt.walk([&walked](store::node_type type, store::const_node_ptr nd, int, int) {
+			if (type == store::node_t::NODE_LEAF) walked.push_back(nd->path());
+		});
+		REQUIRE(std::equal(walked.begin(), walked.end(), keys.begin(), keys.end()));
+	}
+
+	GIVEN("forward and backward iteration") {
+		std::vector<std::string> forward;
+		for (auto it = tt.begin(); it != tt.end(); ++it) forward.push_back(it.key());
+		REQUIRE(std::equal(forward.begin(), forward.end(), keys.begin(), keys.end()));
+
+		std::vector<std::string> backward;
+		for (auto it = tt.end(); it != tt.begin();) backward.push_back((--it).key());
+		REQUIRE(std::equal(backward.begin(), backward.end(), keys.rbegin(), keys.rend()));
+
+		static_assert(std::bidirectional_iterator<store::const_iterator>);
+		REQUIRE(std::size_t(std::distance(tt.begin(), tt.end())) == keys.size());
+		REQUIRE(store{}.begin() == store{}.end());
+	}
+
+	GIVEN("lower_bound, upper_bound and equal_range") {
+		std::mt19937 rng(13);
+		char const alphabet[] = "ab.zA~\x7f";
+		for (int i = 0; i < 3000; i++) {
+			std::string probe{i % 10 == 0 ? "" : "k"};
+			for (auto len = rng() % 9; len > 0; len--) probe += alphabet[rng() % (sizeof(alphabet) - 1)];
+			if (i % 3 == 0) probe = *std::next(keys.begin(), std::ptrdiff_t(rng() % keys.size()));
+
+			auto lb = tt.lower_bound(probe.c_str());
+			auto const lb_expected = keys.lower_bound(probe);
+			if (lb_expected == keys.end()) {
+				REQUIRE(lb == tt.end());
+			} else {
+				REQUIRE(lb != tt.end());
+				REQUIRE(lb.key() == *lb_expected);
+			}
+
+			auto ub = tt.upper_bound(probe.c_str());
+			auto const ub_expected = keys.upper_bound(probe);
+			REQUIRE((ub == tt.end()) == (ub_expected == keys.end()));
+			if (ub_expected != keys.end()) REQUIRE(ub.key() == *ub_expected);
+
+			auto [first, last] = tt.equal_range(probe.c_str());
+			REQUIRE(std::distance(first, last) == (keys.count(probe) ? 1 : 0));
+		}
+	}
+
+	GIVEN("a range scan") {
+		std::vector<std::string> scanned;
+		for (auto it = tt.lower_bound("ka"), e = tt.lower_bound("kz"); it != e; ++it)
+			scanned.push_back(it.key());
+		REQUIRE(std::equal(scanned.begin(), scanned.end(), keys.lower_bound("ka"), keys.lower_bound("kz")));
+		REQUIRE(!scanned.empty());
+	}
+}
+
+SCENARIO("trie/order: lazy scan_prefix", "[trie][order][scan]") {
+	using namespace trie::tests;
+	store tt;
+	std::set<std::string> keys;
+	build_random_keys(tt, keys, 3000, 9);
+
+	GIVEN("all prefixes of a sample of keys") {
+		std::mt19937 rng(17);
+		for (int i = 0; i < 200; i++) {
+			auto const &key = *std::next(keys.begin(), std::ptrdiff_t(rng() % keys.size()));
+			auto const prefix = key.substr(0, rng() % (key.size() + 1));
+
+			std::vector<std::string> expected;
+			for (auto it = keys.lower_bound(prefix); it != keys.end() && it->compare(0, prefix.size(), prefix) == 0; ++it)
+				expected.push_back(*it);
+
+			std::vector<std::string> scanned;
+			for (auto [k, v] : std::as_const(tt).scan_prefix(prefix)) {
+				scanned.emplace_back(k);
+				REQUIRE(std::get<int>(v) == std::get<int>(tt.root()->get(scanned.back().c_str())));
+			}
+			REQUIRE(scanned == expected);
+			REQUIRE(tt.count_prefix(prefix.c_str()) == expected.size());
+		}
+		REQUIRE(std::ranges::distance(tt.scan_prefix("no-such-prefix")) == 0);
+	}
+
+	GIVEN("stop early, and update the values") {
+		int n{0};
+		for (auto [k, v] : tt.scan_prefix("k")) {
+			v = -1;
+			if (++n == 50) break;
+		}
+		REQUIRE(n == 50);
+		auto it = tt.begin();
+		for (int i = 0; i < 50; i++, ++it) REQUIRE(std::get<int>(it->value()) == -1);
+		REQUIRE(std::get<int>(it->value()) != -1);
+	}
+}
+
+SCENARIO("trie/order: template walk", "[trie][order][walk]") {
+	using namespace trie::tests;
+	using node_t = store::node_t;
+	store tt;
+	std::set<std::string> keys;
+	build_random_keys(tt, keys, 3000, 23);
+
+	using visit = std::tuple<std::string, int, int>;
+	std::vector<visit> expected;
+	tt.walk([&expected](auto, auto ptr, int index, int level) {
+		expected.emplace_back(ptr->path(), index, level);
+	});
+
+	GIVEN("a visitor returning void") {
+		std::vector<visit> visited;
+		std::size_t leaves{};
+		REQUIRE(tt.walk([&](node_t const &nd, int index, int level) {
+			visited.emplace_back(nd.path(), index, level);
+			if (nd.type() == node_t::NODE_LEAF) leaves++;
+		}));
+		REQUIRE(visited == expected);
+		REQUIRE(leaves == tt.size());
+	}
+
+	GIVEN("prune the subtrees below level 2") {
+		std::vector<visit> visited;
+		REQUIRE(tt.walk([&visited](node_t const &nd, int index, int level) {
+			visited.emplace_back(nd.path(), index, level);
+			return level < 2 ? node_t::WALK_CONTINUE : node_t::WALK_PRUNE;
+		}));
+		std::vector<visit> shallow;
+		std::ranges::copy_if(expected, std::back_inserter(shallow), [](auto const &v) { return std::get<2>(v) <= 2; });
+		REQUIRE(visited == shallow);
+	}
+
+	GIVEN("stop after 10 nodes") {
+		int n{0};
+		REQUIRE_FALSE(tt.walk([&n](node_t const &, int, int) {
+			return ++n == 10 ? node_t::WALK_STOP : node_t::WALK_CONTINUE;
+		}));
+		REQUIRE(n == 10);
+	}
+}
+
+SCENARIO("trie/order: front-coded key sets", "[trie][order][frontcode]") {
+	using namespace trie::tests;
+	store tt;
+	std::set<std::string> keys;
+	build_random_keys(tt, keys, 3000, 17);
+
+	std::string buf;
+	REQUIRE(tt.export_keys(buf, 8) == keys.size());
+	std::size_t text_size{};
+	for (auto const &k : keys) text_size += k.size() + 1;
+	REQUIRE(buf.size() < text_size);
+
+	GIVEN("a reader") {
+		trie::frontcode::reader r(buf);
+		REQUIRE(r.valid());
+		REQUIRE(r.size() == keys.size());
+		std::vector<std::string> scanned;
+		REQUIRE(r.scan([&scanned](std::string_view key, std::size_t) { scanned.emplace_back(key); }));
+		REQUIRE(std::equal(scanned.begin(), scanned.end(), keys.begin(), keys.end()));
+
+		std::mt19937 rng(3);
+		char const alphabet[] = "ab.zA~";
+		for (int i = 0; i < 3000; i++) {
+			std::string probe{"k"};
+			for (auto len = rng() % 8; len > 0; len--) probe += alphabet[rng() % (sizeof(alphabet) - 1)];
+			REQUIRE(r.contains(probe) == keys.contains(probe));
+			std::string first;
+			r.scan(probe, [&first](std::string_view key, std::size_t) {
+				first = key;
+				return false;
+			});
+			auto lb = keys.lower_bound(probe);
+			REQUIRE(first == (lb == keys.end() ? std::string{} : *lb));
+		}
+	}
+
+	GIVEN("an import into an empty trie") {
+		store loaded;
+		REQUIRE(loaded.import_keys(buf, [&tt](std::string_view key) { return std::as_const(tt).root()->get(std::string(key).c_str()); }));
+		REQUIRE(loaded.size() == tt.size());
+		std::stringstream a, b;
+		tt.dump(a);
+		loaded.dump(b);
+		REQUIRE(a.str() == b.str()); // the same radix tree as one built by insert()
+		REQUIRE(loaded.count_prefix("ka") == tt.count_prefix("ka"));
+	}
+
+	GIVEN("a bulk builder given keys out of order, and a non-empty trie") {
+		store loaded;
+		loaded.insert("kz", 1);
+		loaded.insert("kaaa", 2);
+		auto b = loaded.bulk();
+		REQUIRE(b.add("ka", 3).ok);
+		REQUIRE(b.add("kab", 4).ok);
+		REQUIRE(b.add("kaa", 5).ok); // out of order
+		REQUIRE(b.add("kzz", 6).ok);
+		REQUIRE(b.add("kz", 7).ok); // an update
+		REQUIRE_FALSE(b.add("", 0).ok);
+		std::vector<std::string> got;
+		for (auto it = loaded.begin(); it != loaded.end(); ++it) got.push_back(it.key());
+		REQUIRE(got == std::vector<std::string>{"ka", "kaa", "kaaa", "kab", "kz", "kzz"});
+		REQUIRE(loaded.get<int>("kz") == 7);
+		REQUIRE(loaded.size() == 6);
+	}
+
+	GIVEN("corrupt buffers") {
+		store loaded;
+		REQUIRE_FALSE(loaded.import_keys("not a key set"));
+		REQUIRE_FALSE(trie::frontcode::reader(std::string_view(buf).substr(0, buf.size() - 1)).valid());
+		std::mt19937 rng(11);
+		for (int i = 0; i < 200; i++) {
+			auto bad = buf;
+			bad[4 + rng() % (bad.size() - 4)] ^= char(1 + rng() % 255);
+			trie::frontcode::reader r(bad);
+			std::size_t n{};
+			r.scan([&n](std::string_view, std::size_t) { n++; }); // never reads out of the buffer
+			REQUIRE(n <= r.size());
+		}
+
+		// a length varint running past the entries into the restart index
+		std::string one;
+		trie::frontcode::writer w(one);
+		w.add("ab");
+		w.finish();
+		for (std::size_t i = 5; i < 8; i++) one[i] = char(0x80);
+		trie::frontcode::reader r(one);
+		REQUIRE(r.valid());
+		std::size_t n{};
+		REQUIRE_FALSE(r.scan([&n](std::string_view, std::size_t) { n++; }));
+		REQUIRE(n == 0);
+		REQUIRE_FALSE(r.contains("ab"));
+	}
+}
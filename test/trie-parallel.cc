@@ -0,0 +1,81 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "trie-cxx/trie-core.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+
+	inline void build_sectioned_trie(store &tt, int count) {
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics"};
+		for (int i = 0; i < count; i++) {
+			auto const key = std::string("app.") + sections[i % 7] + ".k" + std::to_string(i);
+			tt.insert(key.c_str(), int(i));
+		}
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/parallel: subtree operations on a thread pool", "[trie][parallel]") {
+	using namespace trie::tests;
+	store tt;
+	build_sectioned_trie(tt, 5000);
+	trie::pool::thread_pool pool(4);
+
+	GIVEN("parallel_walk") {
+		std::atomic<int> leaves{0};
+		std::mutex mu;
+		std::vector<std::string> keys;
+		tt.parallel_walk([&](store::node_type type, store::const_node_ptr nd, int, int) {
+			if (type != store::node_t::NODE_LEAF) return;
+			leaves++;
+			std::lock_guard lock(mu);
+			keys.push_back(nd->path());
+		},
+		                 pool);
+		REQUIRE(leaves == 5000);
+		std::sort(keys.begin(), keys.end());
+		REQUIRE(std::unique(keys.begin(), keys.end()) == keys.end());
+	}
+
+	GIVEN("parallel_size") {
+		REQUIRE(tt.parallel_size(pool) == tt.size());
+		store empty;
+		REQUIRE(empty.parallel_size(pool) == 0);
+	}
+
+	GIVEN("parallel_dump renders the same text as dump") {
+		std::stringstream ss;
+		tt.dump(ss);
+		REQUIRE(tt.parallel_dump(pool) == ss.str());
+	}
+
+	GIVEN("parallel_reduce over a prefix") {
+		long expected{0};
+		for (int i = 0; i < 5000; i++)
+			if (i % 7 == 3) expected += i; // app.db.*
+		auto sum = tt.parallel_reduce(
+		        "app.db.", 0L, [](store::node_t const &nd) { return long(std::get<int>(nd.value())); },
+		        std::plus<long>{}, pool);
+		REQUIRE(sum == expected);
+		REQUIRE(tt.parallel_reduce("app.nothing", 7L, [](store::node_t const &) { return 1L; }, std::plus<long>{}, pool) == 7);
+	}
+}
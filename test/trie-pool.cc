@@ -0,0 +1,155 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-pool.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	// sums [lo, hi) by forking the halves into the same group, down
+	// to small ranges, which exercises the stealing and the helping
+	// wait of nested task groups.
+	template<typename Executor>
+	auto forked_sum(Executor &ex, long lo, long hi) -> long {
+		if (hi - lo <= 64) {
+			long sum{0};
+			for (auto i = lo; i < hi; i++) sum += i;
+			return sum;
+		}
+		auto const mid = lo + (hi - lo) / 2;
+		long left{0};
+		trie::pool::task_group tg;
+		tg.run(ex, [&ex, &left, lo, mid] { left = forked_sum(ex, lo, mid); });
+		auto right = forked_sum(ex, mid, hi);
+		tg.wait(ex);
+		return left + right;
+	}
+
+	// an external executor which runs each task on the submitting thread
+	struct inline_executor {
+		std::atomic<int> submitted{0};
+		void submit(trie::pool::task_t task) {
+			submitted++;
+			task();
+		}
+	};
+} // namespace trie::tests
+
+SCENARIO("trie/pool: work-stealing thread pool", "[trie][pool]") {
+	using namespace trie::tests;
+
+	GIVEN("a configured count of workers") {
+		trie::pool::thread_pool pool(3);
+		REQUIRE(pool.size() == 3);
+
+		std::atomic<int> done{0};
+		trie::pool::task_group tg;
+		for (int i = 0; i < 1000; i++) tg.run(pool, [&done] { done++; });
+		tg.wait(pool);
+		REQUIRE(done == 1000);
+	}
+
+	GIVEN("nested fork-join") {
+		trie::pool::thread_pool pool(2);
+		REQUIRE(forked_sum(pool, 0, 100000) == 100000L * 99999 / 2);
+
+		// a single worker must not deadlock when a task waits for
+		// the tasks it forked.
+		trie::pool::thread_pool one(1);
+		long sum{0};
+		trie::pool::task_group tg;
+		tg.run(one, [&one, &sum] { sum = forked_sum(one, 0, 10000); });
+		tg.wait(one);
+		REQUIRE(sum == 10000L * 9999 / 2);
+	}
+
+	GIVEN("throwing tasks") {
+		trie::pool::thread_pool pool(2);
+		std::atomic<int> done{0};
+		trie::pool::task_group tg;
+		for (int i = 0; i < 1000; i++) {
+			tg.run(pool, [&done, i] {
+				if (i % 100 == 0) throw std::runtime_error("task " + std::to_string(i));
+				done++;
+			});
+		}
+		REQUIRE_THROWS_AS(tg.wait(pool), std::runtime_error);
+		REQUIRE(done == 990);
+
+		// the error is reported once, the group can be reused
+		tg.run(pool, [&done] { done++; });
+		tg.wait(pool);
+		REQUIRE(done == 991);
+	}
+
+	GIVEN("idle workers park") {
+		trie::pool::thread_pool pool(2);
+		auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+		while (pool.parked() < pool.size() && std::chrono::steady_clock::now() < deadline)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		REQUIRE(pool.parked() == pool.size());
+
+		// and wake up for new work
+		std::atomic<bool> ran{false};
+		trie::pool::task_group tg;
+		tg.run(pool, [&ran] { ran = true; });
+		tg.wait(pool);
+		REQUIRE(ran);
+	}
+}
+
+SCENARIO("trie/pool: pluggable executors", "[trie][pool]") {
+	using namespace trie::tests;
+	trie::trie_t<trie::value_t> tt;
+	for (int i = 0; i < 2000; i++) {
+		auto const key = "app.s" + std::to_string(i % 5) + ".k" + std::to_string(i);
+		tt.insert(key.c_str(), int(i));
+	}
+
+	GIVEN("the default executor") {
+		REQUIRE(tt.parallel_size() == 2000);
+	}
+
+	GIVEN("an external executor plugged in at runtime") {
+		inline_executor ex;
+		trie::pool::use_executor(ex);
+		REQUIRE(tt.parallel_size() == 2000);
+		REQUIRE(tt.parallel_dump() == tt.parallel_dump(trie::pool::default_pool()));
+		trie::pool::use_default_executor();
+		REQUIRE(ex.submitted > 0);
+	}
+
+	GIVEN("an external executor passed explicitly") {
+		inline_executor ex;
+		std::atomic<int> leaves{0};
+		tt.parallel_walk([&leaves](auto type, auto, int, int) {
+			if (type == trie::trie_t<trie::value_t>::node_t::NODE_LEAF) leaves++;
+		},
+		                 ex);
+		REQUIRE(leaves == 2000);
+	}
+
+	GIVEN("a throwing callback") {
+		REQUIRE_THROWS_AS(tt.parallel_walk([](auto type, auto, int, int) {
+			if (type == trie::trie_t<trie::value_t>::node_t::NODE_LEAF) throw std::runtime_error("stop");
+		}),
+		                  std::runtime_error);
+		REQUIRE(tt.parallel_size() == 2000);
+	}
+}
@@ -0,0 +1,191 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-core.hh"
+
+#include <algorithm>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Query benchmarks on a large store.
+//
+// Run this:
+//
+//    ./bin/test-trie-query-bench [keys] [queries]
+//
+// fuzzy_find: typo-tolerant lookups of dictionary-like keys, with 1
+// and 2 edits.
+//
+// glob: wildcard queries over config-like keys
+// ("app.s<n>.n<n>.<name>"), the guided traversal against a walk
+// which matches every key.
+//
+// complete: top-10 autocomplete of 1-3 byte prefixes over the
+// dictionary-like keys with Zipf-like weights, against a walk of the
+// prefix subtree which sorts its weighted keys.
+//
+// regex_find: the config keys, regex_find() against std::regex_match
+// on each key of a walk.
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+
+	template<typename Fn>
+	auto time_ms(Fn &&fn) -> double {
+		double ms{};
+		{
+			trie::chrono::timer tr([&ms](auto duration) -> bool {
+				ms = duration;
+				return false;
+			});
+			fn();
+		}
+		return ms;
+	}
+
+	inline auto build_words(store &tt, std::vector<std::string> &words, int count) -> void {
+		std::mt19937_64 rng(1);
+		for (int i = 0; i < count; i++) {
+			std::string word;
+			for (auto len = 6 + rng() % 7; len > 0; len--) word += char('a' + rng() % 26);
+			tt.insert(word.c_str(), i);
+			words.push_back(std::move(word));
+		}
+	}
+
+	void bench_fuzzy(store const &tt, std::vector<std::string> const &words, int queries) {
+		std::mt19937_64 rng(2);
+		for (std::size_t edits : {1u, 2u}) {
+			std::size_t found{};
+			auto const ms = time_ms([&] {
+				for (int i = 0; i < queries; i++) {
+					auto query = words[rng() % words.size()];
+					query[rng() % query.size()] = char('a' + rng() % 26); // a typo
+					found += tt.fuzzy_find(query, edits).size();
+				}
+			});
+			std::cout << "fuzzy_find, max_edits=" << edits << ": " << (ms * 1000 / queries) << "us/query"
+			          << " (matches: " << found << ")" << '\n';
+		}
+	}
+
+	void bench_complete(store &tt, std::vector<std::string> const &words, int queries) {
+		std::mt19937_64 rng(3);
+		auto const setup = time_ms([&] {
+			for (std::size_t i = 0; i < words.size(); i++) tt.set_weight(words[i].c_str(), 1e6 / double(1 + rng() % words.size()));
+		});
+		std::cout << "set_weight: " << (setup * 1000 / double(words.size())) << "us/key" << '\n';
+
+		std::vector<std::string> prefixes;
+		for (int i = 0; i < queries; i++) prefixes.push_back(words[rng() % words.size()].substr(0, 1 + rng() % 3));
+		for (std::size_t k : {10u, 50u}) {
+			std::size_t found{};
+			auto const cached = time_ms([&] {
+				for (auto const &prefix : prefixes) found += tt.complete(prefix.c_str(), k).size();
+			});
+
+			std::size_t sorted{};
+			auto const walked = time_ms([&] {
+				for (auto const &prefix : prefixes) {
+					std::vector<store::completion_s> all;
+					if (auto nd = tt.prefix_node(prefix.c_str())) {
+						nd->walk([&all](store::node_t const &x, int, int) {
+							if (x.weighted()) all.push_back({&x, x.weight()});
+						});
+					}
+					auto const n = std::min(k, all.size());
+					std::partial_sort(all.begin(), all.begin() + std::ptrdiff_t(n), all.end(), store::node_t::better);
+					sorted += n;
+				}
+			});
+			std::cout << "complete, k=" << k << ": " << (cached * 1000 / queries) << "us/query, walk+sort: "
+			          << (walked * 1000 / queries) << "us/query (results: " << found << "/" << sorted << ")" << '\n';
+		}
+	}
+
+	inline auto build_config(store &tt, int count) -> void {
+		static char const *names[] = {"timeout", "port", "host", "file", "level", "retries", "user", "path", "size", "mode"};
+		for (int i = 0; i < count; i++) {
+			auto const key = "app.s" + std::to_string(i % 100) + ".n" + std::to_string(i / 100 % 100) + "." +
+			                 names[i / 10000 % 10] + std::to_string(i / 100000);
+			tt.insert(key.c_str(), i);
+		}
+	}
+
+	void bench_glob(store const &tt, int rounds) {
+		for (auto const *pattern : {"app.s42.*.timeout0", "app.s4?.n1[0-3].port*", "app.**.level3", "**.file[1-2]", "app.s7.**"}) {
+			std::size_t found{};
+			auto const guided = time_ms([&] {
+				for (int i = 0; i < rounds; i++) found = tt.glob(pattern).size();
+			});
+
+			std::size_t filtered{};
+			auto a = trie::query::compile_glob(pattern);
+			auto const walked = time_ms([&] {
+				for (int i = 0; i < rounds; i++) {
+					filtered = 0;
+					tt.walk([&](store::node_t const &nd, int, int) {
+						if (nd.type() == store::node_t::NODE_LEAF && a.matches(nd.path())) filtered++;
+					});
+				}
+			});
+			std::cout << "glob " << pattern << ": " << (guided / rounds) << "ms, walk+filter: " << (walked / rounds)
+			          << "ms (matches: " << found << "/" << filtered << ")" << '\n';
+		}
+	}
+
+	void bench_regex(store const &tt, int rounds) {
+		for (auto const *pattern : {R"(app\.s42\.n\d+\.timeout0)", R"(app\.s(1|2)\d\.n7\.(port|host)\d)", R"(.*\.level3)", R"(app\.s[0-9]{2}\.n5\..*)"}) {
+			std::size_t found{};
+			auto const guided = time_ms([&] {
+				for (int i = 0; i < rounds; i++) found = tt.regex_find(pattern).matches.size();
+			});
+
+			std::size_t filtered{};
+			std::regex const re(pattern);
+			auto const walked = time_ms([&] {
+				for (int i = 0; i < rounds; i++) {
+					filtered = 0;
+					tt.walk([&](store::node_t const &nd, int, int) {
+						if (nd.type() == store::node_t::NODE_LEAF && std::regex_match(nd.path(), re)) filtered++;
+					});
+				}
+			});
+			std::cout << "regex " << pattern << ": " << (guided / rounds) << "ms, walk+std::regex: " << (walked / rounds)
+			          << "ms (matches: " << found << "/" << filtered << ")" << '\n';
+		}
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	using namespace trie::tests;
+	int keys{1000000}, queries{1000};
+	if (argc > 1) keys = std::max(1, std::atoi(argv[1]));
+	if (argc > 2) queries = std::max(1, std::atoi(argv[2]));
+
+	store tt;
+	std::vector<std::string> words;
+	build_words(tt, words, keys);
+	std::cout << "store: " << tt.size() << " keys" << '\n';
+
+	bench_fuzzy(tt, words, queries);
+	bench_complete(tt, words, queries);
+
+	store config;
+	build_config(config, keys);
+	std::cout << "store: " << config.size() << " keys" << '\n';
+	bench_glob(config, 3);
+	bench_regex(config, 1);
+	return 0;
+}
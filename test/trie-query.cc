@@ -0,0 +1,409 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <regex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trie-cxx/trie-core.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+
+	inline auto levenshtein(std::string_view a, std::string_view b) -> std::size_t {
+		std::vector<std::size_t> row(b.size() + 1);
+		for (std::size_t j = 0; j <= b.size(); j++) row[j] = j;
+		for (std::size_t i = 1; i <= a.size(); i++) {
+			auto diag = row[0];
+			row[0] = i;
+			for (std::size_t j = 1; j <= b.size(); j++) {
+				auto const up = row[j];
+				row[j] = std::min({row[j] + 1, row[j - 1] + 1, diag + (a[i - 1] != b[j - 1])});
+				diag = up;
+			}
+		}
+		return row[b.size()];
+	}
+
+	// a backtracking glob matcher as the reference of trie_t::glob()
+	inline auto glob_ref(std::string_view p, std::string_view s) -> bool {
+		if (p.empty()) return s.empty();
+		if (p.starts_with("**.")) {
+			if (glob_ref(p.substr(3), s)) return true;
+			for (std::size_t i = 0; i < s.size(); i++) {
+				if (s[i] == '.' && glob_ref(p.substr(3), s.substr(i + 1))) return true;
+			}
+			return false;
+		}
+		if (p.starts_with("**")) {
+			for (std::size_t i = 0; i <= s.size(); i++) {
+				if (glob_ref(p.substr(2), s.substr(i))) return true;
+			}
+			return false;
+		}
+		if (p[0] == '*') {
+			for (std::size_t i = 0;; i++) {
+				if (glob_ref(p.substr(1), s.substr(i))) return true;
+				if (i == s.size() || s[i] == '.') return false;
+			}
+		}
+		if (s.empty() || s[0] == '.' && (p[0] == '?' || p[0] == '[')) return false;
+		if (p[0] == '?') return glob_ref(p.substr(1), s.substr(1));
+		if (p[0] == '[') {
+			auto const close = p.find(']');
+			auto set = p.substr(1, close - 1);
+			bool const negate = set.starts_with('!');
+			if (negate) set.remove_prefix(1);
+			return (set.find(s[0]) != std::string_view::npos) != negate && glob_ref(p.substr(close + 1), s.substr(1));
+		}
+		return p[0] == s[0] && glob_ref(p.substr(1), s.substr(1));
+	}
+
+	inline auto random_key(std::mt19937 &rng) -> std::string {
+		static char const *sections[] = {"app", "server", "logging", "db", "cache"};
+		std::string key{sections[rng() % 5]};
+		for (auto n = 1 + rng() % 3; n > 0; n--) {
+			key += '.';
+			for (auto len = 1 + rng() % 5; len > 0; len--) key += char('a' + rng() % 6);
+		}
+		return key;
+	}
+
+	// a random regex over the alphabet of random_key()
+	inline auto random_regex(std::mt19937 &rng, int depth = 0) -> std::string {
+		static char const *atoms[] = {"a", "b", "c", "d", "\\.", ".", "[a-c]", "[^a.]", "\\w", "app", "db"};
+		static char const *quantifiers[] = {"*", "+", "?", "{2}", "{1,3}", "{0,}"};
+		std::string ret;
+		for (auto n = 1 + rng() % 5; n > 0; n--) {
+			if (depth < 2 && rng() % 6 == 0) ret += "(" + random_regex(rng, depth + 1) + "|" + random_regex(rng, depth + 1) + ")";
+			else ret += atoms[rng() % std::size(atoms)];
+			if (rng() % 3 == 0) ret += quantifiers[rng() % std::size(quantifiers)];
+		}
+		return ret;
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/query: fuzzy_find", "[trie][query][fuzzy]") {
+	using namespace trie::tests;
+	store tt;
+	std::set<std::string> keys;
+	std::mt19937 rng(5);
+	for (int i = 0; i < 2000; i++) {
+		auto const key = random_key(rng);
+		tt.insert(key.c_str(), i);
+		keys.insert(key);
+	}
+
+	GIVEN("a small store") {
+		store s;
+		s.insert("app.logging.file", 1);
+		s.insert("app.logging.level", 2);
+		s.insert("app.server.port", 3);
+		auto found = s.fuzzy_find("app.loging.file", 1);
+		REQUIRE(found.size() == 1);
+		REQUIRE(found[0].ptr->path() == "app.logging.file");
+		REQUIRE(found[0].distance == 1);
+
+		found = s.fuzzy_find("app.logging.file", 0);
+		REQUIRE((found.size() == 1 && found[0].distance == 0));
+		REQUIRE(s.fuzzy_find("app.logging.fil", 6).size() == 2);
+		REQUIRE(s.fuzzy_find("xyz", 2).empty());
+		REQUIRE(s.fuzzy_find("", 16).size() == 2); // the lengths of the keys
+	}
+
+	GIVEN("queries near the keys, against a brute-force scan") {
+		for (int i = 0; i < 100; i++) {
+			auto query = *std::next(keys.begin(), std::ptrdiff_t(rng() % keys.size()));
+			for (auto edits = rng() % 3; edits > 0; edits--) {
+				auto const pos = rng() % (query.size() + 1);
+				switch (rng() % 3) {
+					case 0: query.insert(pos, 1, char('a' + rng() % 6)); break;
+					case 1:
+						if (pos < query.size()) query.erase(pos, 1);
+						break;
+					default:
+						if (pos < query.size()) query[pos] = char('a' + rng() % 6);
+				}
+			}
+			auto const max_edits = rng() % 4;
+
+			std::vector<std::pair<std::size_t, std::string>> expected;
+			for (auto const &key : keys) {
+				if (auto d = levenshtein(key, query); d <= max_edits) expected.emplace_back(d, key);
+			}
+			std::stable_sort(expected.begin(), expected.end(), [](auto const &a, auto const &b) { return a.first < b.first; });
+
+			std::vector<std::pair<std::size_t, std::string>> found;
+			for (auto const &m : tt.fuzzy_find(query, max_edits)) found.emplace_back(m.distance, m.ptr->path());
+			REQUIRE(found == expected);
+		}
+	}
+}
+
+SCENARIO("trie/query: glob", "[trie][query][glob]") {
+	using namespace trie::tests;
+	auto paths = [](std::vector<store::node_t const *> const &found) {
+		std::vector<std::string> ret;
+		for (auto const *nd : found) ret.push_back(nd->path());
+		return ret;
+	};
+
+	GIVEN("a config store") {
+		store tt;
+		for (auto const *key : {"app.server.timeout", "app.server.http.timeout", "app.server.http.port",
+		                        "app.client.timeout", "app.file", "app.logging.file", "app.logging.rotate.file",
+		                        "app.timeouts", "db.timeout"})
+			tt.insert(key, 1);
+
+		REQUIRE(paths(tt.glob("app.*.timeout")) == std::vector<std::string>{"app.client.timeout", "app.server.timeout"});
+		REQUIRE(paths(tt.glob("app.server.**.timeout")) == std::vector<std::string>{"app.server.http.timeout", "app.server.timeout"});
+		REQUIRE(paths(tt.glob("**.timeout")).size() == 4);
+		REQUIRE(paths(tt.glob("app.**.file")) == std::vector<std::string>{"app.file", "app.logging.file", "app.logging.rotate.file"});
+		REQUIRE(tt.glob("app.**").size() == 8);
+		REQUIRE(paths(tt.glob("app.timeout?")) == std::vector<std::string>{"app.timeouts"});
+		REQUIRE(paths(tt.glob("[a-c]*.*.port")) == std::vector<std::string>{});
+		REQUIRE(paths(tt.glob("[!a]*.timeout")) == std::vector<std::string>{"db.timeout"});
+		REQUIRE(paths(tt.glob("app.server.http.port")) == std::vector<std::string>{"app.server.http.port"});
+		REQUIRE(tt.glob("app.server").empty());
+		REQUIRE(tt.glob("").empty());
+	}
+
+	GIVEN("random patterns, against a backtracking matcher") {
+		store tt;
+		std::set<std::string> keys;
+		std::mt19937 rng(13);
+		for (int i = 0; i < 3000; i++) {
+			auto const key = random_key(rng);
+			tt.insert(key.c_str(), i);
+			keys.insert(key);
+		}
+		static char const *tokens[] = {"a", "b", "c", "ab", ".", ".", "*", "**", "**.", "?", "[ab]", "[!a]", "app", "db"};
+		for (int i = 0; i < 300; i++) {
+			std::string pattern;
+			for (auto n = 1 + rng() % 6; n > 0; n--) pattern += tokens[rng() % std::size(tokens)];
+
+			std::vector<std::string> expected;
+			for (auto const &key : keys) {
+				if (glob_ref(pattern, key)) expected.push_back(key);
+			}
+			REQUIRE(paths(tt.glob(pattern)) == expected);
+		}
+	}
+}
+
+SCENARIO("trie/query: regex_find", "[trie][query][regex]") {
+	using namespace trie::tests;
+	auto paths = [](std::vector<store::node_t const *> const &found) {
+		std::vector<std::string> ret;
+		for (auto const *nd : found) ret.push_back(nd->path());
+		return ret;
+	};
+
+	GIVEN("a config store") {
+		store tt;
+		for (auto const *key : {"app.server.timeout", "app.server.port", "app.server.port2", "app.client.timeout",
+		                        "app.logging.file", "db.timeout", "db.port"})
+			tt.insert(key, 1);
+
+		auto r = tt.regex_find(R"(app\.server\.(port|timeout)\d*)");
+		REQUIRE(r.ok);
+		REQUIRE(paths(r.matches) == std::vector<std::string>{"app.server.port", "app.server.port2", "app.server.timeout"});
+		REQUIRE(paths(tt.regex_find(".*timeout").matches) == std::vector<std::string>{"app.client.timeout", "app.server.timeout", "db.timeout"});
+		REQUIRE(paths(tt.regex_find("^[a-d]{2}\\.\\w+$").matches) == std::vector<std::string>{"db.port", "db.timeout"});
+		REQUIRE(paths(tt.regex_find("app(\\.[^.]+){2}").matches).size() == 5);
+		REQUIRE(tt.regex_find("app").matches.empty()); // a whole key only
+		REQUIRE(tt.regex_find("").matches.empty());
+
+		std::size_t n{};
+		REQUIRE(tt.regex_find("db\\..*", [&n](auto const &) { n++; }));
+		REQUIRE(n == 2);
+	}
+
+	GIVEN("invalid patterns") {
+		store tt;
+		tt.insert("a", 1);
+		for (auto const *pattern : {"(a", "a)", "*a", "a|+", "[ab", "a{2,1}", "a{", "\\1", "(?=a)", "a\\", "a*?", "a+?", "a**", "a{2}?", "a?+"}) {
+			auto r = tt.regex_find(pattern);
+			REQUIRE_FALSE(r.ok);
+			REQUIRE(r.en == EINVAL);
+			REQUIRE_FALSE(tt.regex_find(pattern, [](auto const &) {}));
+		}
+		auto r = tt.regex_find("ab)c");
+		REQUIRE(r.error_pos == 2);
+		REQUIRE(tt.regex_find("ab*?").error_pos == 3);
+		REQUIRE(tt.regex_find("a{2}+").error_pos == 4);
+	}
+
+	GIVEN("deeply nested patterns") {
+		store tt;
+		tt.insert("a", 1);
+		REQUIRE_FALSE(tt.regex_find(std::string(200000, '(') + "a" + std::string(200000, ')')).ok);
+		REQUIRE_FALSE(tt.regex_find("a" + std::string(200000, '?')).ok);
+		REQUIRE(tt.regex_find(std::string(100, '(') + "a" + std::string(100, ')')).matches.size() == 1);
+
+		std::string alts{"a"};
+		for (int i = 0; i < 20000; i++) alts += "|b";
+		REQUIRE(tt.regex_find(alts).matches.size() == 1);
+	}
+
+	GIVEN("random patterns, against std::regex_match") {
+		store tt;
+		std::set<std::string> keys;
+		std::mt19937 rng(17);
+		for (int i = 0; i < 3000; i++) {
+			auto const key = random_key(rng);
+			tt.insert(key.c_str(), i);
+			keys.insert(key);
+		}
+		for (int i = 0; i < 300; i++) {
+			auto const pattern = random_regex(rng);
+			std::regex const re(pattern);
+			std::vector<std::string> expected;
+			for (auto const &key : keys) {
+				if (std::regex_match(key, re)) expected.push_back(key);
+			}
+			auto r = tt.regex_find(pattern);
+			REQUIRE(r.ok);
+			REQUIRE(paths(r.matches) == expected);
+		}
+	}
+
+	GIVEN("a pattern whose DFA blows up") {
+		// `.*a.{12}` needs a state per suffix of 13 bytes, 8192 of
+		// them over a two-letter alphabet.
+		std::string const pattern{".*a.{12}"};
+		std::regex const re(pattern);
+		std::mt19937 rng(23);
+		std::vector<std::string> keys;
+		for (int i = 0; i < 6000; i++) {
+			std::string key;
+			for (auto len = 13 + rng() % 12; len > 0; len--) key += char('a' + rng() % 2);
+			keys.push_back(std::move(key));
+		}
+
+		auto a = *trie::query::compile_regex(pattern);
+		a.max_states(64);
+		for (auto const &key : keys) {
+			REQUIRE(a.matches(key) == std::regex_match(key, re));
+			REQUIRE(a.states() <= a.max_states());
+		}
+		REQUIRE(a.flushes() > 0);
+
+		// and along a trie walk, over the default budget
+		store tt;
+		std::set<std::string> expected;
+		for (auto const &key : keys) {
+			tt.insert(key.c_str(), 1);
+			if (std::regex_match(key, re)) expected.insert(key);
+		}
+		auto r = tt.regex_find(pattern);
+		REQUIRE(r.ok);
+		REQUIRE(paths(r.matches) == std::vector<std::string>(expected.begin(), expected.end()));
+	}
+}
+
+SCENARIO("trie/query: complete", "[trie][query][complete]") {
+	using namespace trie::tests;
+	using completion_s = store::completion_s;
+	auto paths = [](std::vector<completion_s> const &found) {
+		std::vector<std::pair<double, std::string>> ret;
+		for (auto const &c : found) ret.emplace_back(c.weight, c.ptr->path());
+		return ret;
+	};
+
+	GIVEN("a few weighted keys") {
+		store tt;
+		for (auto const *key : {"he", "hello", "help", "helmet", "hero", "world"}) tt.insert(key, 1);
+		REQUIRE(tt.set_weight("hello", 5));
+		REQUIRE(tt.set_weight("help", 9));
+		REQUIRE(tt.set_weight("hero", 5));
+		REQUIRE(tt.set_weight("world", 7));
+		REQUIRE_FALSE(tt.set_weight("hel", 1)); // not a key
+		REQUIRE_FALSE(tt.set_weight("nothing", 1));
+
+		using list = std::vector<std::pair<double, std::string>>;
+		REQUIRE(paths(tt.complete("he", 10)) == list{{9, "help"}, {5, "hello"}, {5, "hero"}});
+		REQUIRE(paths(tt.complete("", 2)) == list{{9, "help"}, {7, "world"}});
+		REQUIRE(paths(tt.complete("hel", 1)) == list{{9, "help"}});
+		REQUIRE(tt.complete("x", 3).empty());
+
+		tt.insert("helper", 1);
+		tt.insert("hell", 1); // splits "lo" into "l" and "o"
+		REQUIRE(tt.set_weight("hell", 10));
+		REQUIRE(paths(tt.complete("he", 2)) == list{{10, "hell"}, {9, "help"}});
+		tt.remove("help"); // and "helper"
+		REQUIRE(paths(tt.complete("he", 10)) == list{{10, "hell"}, {5, "hello"}, {5, "hero"}});
+		tt.remove("helmet"); // merges the branch "hel" with "l"
+		REQUIRE(paths(tt.complete("hel", 10)) == list{{10, "hell"}, {5, "hello"}});
+		REQUIRE(tt.clear_weight("hell"));
+		REQUIRE_FALSE(tt.clear_weight("hell"));
+		REQUIRE(paths(tt.complete("", 10)) == list{{7, "world"}, {5, "hello"}, {5, "hero"}});
+	}
+
+	GIVEN("random inserts, weights and removes, against a brute-force scan") {
+		store tt;
+		std::map<std::string, double> weights;
+		std::set<std::string> keys;
+		std::mt19937 rng(23);
+		auto brute = [&](std::string const &prefix, std::size_t k) {
+			std::vector<std::pair<double, std::string>> ret;
+			for (auto const &[key, w] : weights) {
+				if (key.starts_with(prefix)) ret.emplace_back(w, key);
+			}
+			std::stable_sort(ret.begin(), ret.end(), [](auto const &a, auto const &b) { return a.first > b.first; });
+			if (ret.size() > k) ret.resize(k);
+			return ret;
+		};
+		for (int round = 0; round < 4000; round++) {
+			auto const key = random_key(rng);
+			switch (rng() % 4) {
+				case 0:
+				case 1:
+					tt.insert(key.c_str(), round);
+					keys.insert(key);
+					if (rng() % 3 != 0) {
+						auto const w = double(rng() % 50);
+						REQUIRE(tt.set_weight(key.c_str(), w));
+						weights[key] = w;
+					}
+					break;
+				case 2:
+					if (!keys.empty()) {
+						auto const victim = *std::next(keys.begin(), std::ptrdiff_t(rng() % keys.size()));
+						if (tt.remove(victim.c_str(), false).ok) { // a key with keys below stays
+							keys.erase(victim);
+							weights.erase(victim);
+						}
+					}
+					break;
+				default:
+					if (!weights.empty() && rng() % 2) {
+						auto const it = std::next(weights.begin(), std::ptrdiff_t(rng() % weights.size()));
+						REQUIRE(tt.clear_weight(it->first.c_str()));
+						weights.erase(it);
+					}
+			}
+			if (round % 20 == 0) {
+				auto const prefix = random_key(rng).substr(0, rng() % 6);
+				for (std::size_t k : {1u, 5u, 10u, 25u, 1000u}) REQUIRE(paths(tt.complete(prefix.c_str(), k)) == brute(prefix, k));
+			}
+		}
+	}
+}
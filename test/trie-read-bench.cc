@@ -0,0 +1,129 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-core.hh"
+#include "trie-cxx/trie-segment.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Multi-threaded read benchmark on a frozen trie_t: no lock at all,
+// the readers use the const apis only. The throughput shall scale
+// linearly with the reader threads, up to the count of cores.
+//
+// Run this:
+//
+//    ./bin/test-trie-read-bench [max-threads] [keys] [lookups-per-thread]
+//
+// Then, on one thread, the same keys in a segment_trie_t: lookups by
+// interned segment against trie_t::fast_find() and search().
+
+namespace trie::tests {
+	void bench_frozen_reads(unsigned max_threads, int key_count, int lookups) {
+		trie::trie_t<trie::value_t> tt;
+		std::vector<std::string> keys;
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics", "ui"};
+		keys.reserve(std::size_t(key_count));
+		for (int i = 0; i < key_count; i++) {
+			keys.push_back(std::string("app.") + sections[i % 8] + ".item" + std::to_string(i / 8) + ".value");
+			tt.insert(keys.back().c_str(), int(i));
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+		auto const &frozen = tt;
+		double single{0};
+		for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+			std::atomic<long> found{0};
+			double total_ms{0};
+			{
+				trie::chrono::timer tr([&total_ms](auto duration) -> bool {
+					total_ms = duration;
+					return false;
+				});
+
+				std::vector<std::thread> readers;
+				for (unsigned t = 0; t < threads; t++) {
+					readers.emplace_back([&frozen, &keys, &found, lookups, t] {
+						long local{0};
+						auto const n = keys.size();
+						for (int i = 0; i < lookups; i++) {
+							auto const &key = keys[(std::size_t(i) * 7919u + t * 104729u) % n];
+							if (frozen.fast_find(key.c_str()).matched) local++;
+						}
+						found += local;
+					});
+				}
+				for (auto &r : readers) r.join();
+			}
+
+			auto const ops = double(threads) * lookups;
+			auto const mops = ops / total_ms / 1000.0;
+			if (threads == 1) single = mops;
+			std::cout << "frozen fast_find: threads=" << threads << " -> " << mops << " Mops/s, speedup "
+			          << (mops / single) << "x (found: " << found.load() << "/" << long(ops) << ")" << '\n';
+		}
+	}
+
+	void bench_segment_reads(int key_count, int lookups) {
+		trie::trie_t<trie::value_t> tt;
+		trie::segment_trie_t<trie::value_t> st;
+		std::vector<std::string> keys;
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics", "ui"};
+		for (int i = 0; i < key_count; i++) {
+			keys.push_back(std::string("app.") + sections[i % 8] + ".item" + std::to_string(i / 8) + ".value");
+			tt.insert(keys.back().c_str(), int(i));
+			st.insert(keys.back(), int(i));
+		}
+		std::shuffle(keys.begin(), keys.end(), std::mt19937(1));
+
+		auto run = [&keys, lookups](char const *title, auto &&lookup) {
+			long found{0};
+			double ms{0};
+			{
+				trie::chrono::timer tr([&ms](auto duration) -> bool {
+					ms = duration;
+					return false;
+				});
+				for (int i = 0; i < lookups; i++) {
+					if (lookup(keys[(std::size_t(i) * 7919u) % keys.size()])) found++;
+				}
+			}
+			std::cout << title << ": " << (double(lookups) / ms / 1000.0) << " Mops/s (found: " << found << ")" << '\n';
+		};
+		std::size_t occurrences{}, bytes{};
+		st.walk([&](auto const &nd, int) {
+			occurrences++;
+			bytes += nd.segment().size();
+		});
+		std::cout << "segment_trie_t: " << occurrences << " segments (" << bytes << " bytes) interned as "
+		          << st.pool().size() << " (" << st.pool().bytes() << " bytes)" << '\n';
+		run("trie_t fast_find      ", [&tt](std::string const &key) { return tt.fast_find(key.c_str()).matched; });
+		run("trie_t search         ", [&tt](std::string const &key) { return tt.search(key.c_str()).matched; });
+		run("segment_trie_t find   ", [&st](std::string const &key) { return st.find(key) != nullptr; });
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+	int keys{100000}, lookups{1000000};
+	if (argc > 1) max_threads = unsigned(std::max(1, std::atoi(argv[1])));
+	if (argc > 2) keys = std::max(1, std::atoi(argv[2]));
+	if (argc > 3) lookups = std::max(1, std::atoi(argv[3]));
+
+	trie::tests::bench_frozen_reads(max_threads, keys, lookups);
+	trie::tests::bench_segment_reads(keys, lookups);
+	return 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "trie-cxx/trie-intern.hh"
+#include "trie-cxx/trie-segment.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	using segment_store = trie::segment_trie_t<trie::value_t>;
+
+	inline void build_minimal_segment_trie(segment_store &tt) {
+		tt.insert("app.debug", true);
+		tt.insert("app.verbose", true);
+		tt.insert("app.dump", 3);
+		tt.insert("app.logging.file", "~/.trie.log");
+		tt.insert("app.server.start", 5);
+		tt.insert("app.logging.rotate", 6);
+		tt.insert("app.logging.words", std::vector<std::string>{"a", "1", "false"});
+		tt.insert("app.server.sites", 1);
+	}
+
+	inline auto segments_of(segment_store::node_t const *nd) -> std::vector<std::string> {
+		std::vector<std::string> ret;
+		if (nd) {
+			for (auto const &ch : nd->children()) ret.emplace_back(ch->segment());
+		}
+		return ret;
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/segment: intern_pool", "[trie][segment][intern]") {
+	trie::intern_pool pool;
+	REQUIRE(pool.find("timeout") == trie::intern_pool::npos);
+	auto const a = pool.intern("timeout");
+	REQUIRE(pool.intern("port") != a);
+	REQUIRE(pool.intern(std::string("time") + "out") == a);
+	REQUIRE(pool.find("timeout") == a);
+	REQUIRE(pool.view(a) == "timeout");
+	REQUIRE(pool.view(pool.intern("")).empty());
+
+	// the views stay valid while the pool grows
+	auto const first = pool.view(a);
+	std::string const long_one(trie::intern_pool::block_size, 'x');
+	auto const l = pool.intern(long_one);
+	std::vector<trie::intern_pool::id_t> ids;
+	for (int i = 0; i < 20000; i++) ids.push_back(pool.intern("segment-" + std::to_string(i)));
+	REQUIRE(first.data() == pool.view(a).data());
+	REQUIRE(pool.view(l) == long_one);
+	for (int i = 0; i < 20000; i++) {
+		REQUIRE(pool.find("segment-" + std::to_string(i)) == ids[std::size_t(i)]);
+		REQUIRE(pool.view(ids[std::size_t(i)]) == "segment-" + std::to_string(i));
+	}
+	REQUIRE(pool.size() == 20004);
+}
+
+SCENARIO("trie/segment: store", "[trie][segment]") {
+	using namespace trie::tests;
+	segment_store tt;
+	build_minimal_segment_trie(tt);
+	REQUIRE(tt.size() == 8);
+	REQUIRE(tt.pool().size() == 11); // app, debug, ..., logging, file, ..., sites
+
+	GIVEN("lookups") {
+		REQUIRE(std::get<int>(*tt.find("app.dump")) == 3);
+		REQUIRE(std::get<char const *>(tt.get("app.logging.file", 0)) == std::string("~/.trie.log"));
+		REQUIRE(std::get<int>(tt.get("app.nothing", 7)) == 7);
+		REQUIRE(tt.has("app.server.sites"));
+		REQUIRE_FALSE(tt.has("app.server.s"));         // segments are never split
+		REQUIRE_FALSE(tt.has("app.logging"));          // a branch
+		REQUIRE(tt.locate("app.logging.") != nullptr); // a trailing delimiter is ignored
+		REQUIRE(tt.locate("app.logging") == tt.locate("app.logging."));
+		REQUIRE(tt.locate("app.logging")->path() == "app.logging");
+		REQUIRE(tt.locate("") == nullptr);
+
+		REQUIRE(segments_of(tt.locate("app")) == std::vector<std::string>{"debug", "verbose", "dump", "logging", "server"});
+		REQUIRE(segments_of(tt.locate("app.logging")) == std::vector<std::string>{"file", "rotate", "words"});
+		REQUIRE(tt.child(*tt.child(*tt.locate("app"), "server"), "start")->path() == "app.server.start");
+		REQUIRE(tt.child(*tt.locate("app"), "serv") == nullptr);
+		REQUIRE(tt.locate("app.nothing.here") == nullptr);
+	}
+
+	GIVEN("updates and removes") {
+		auto ret = tt.insert("app.dump", 4);
+		REQUIRE((ret.ok && std::get<int>(ret.old) == 3));
+		REQUIRE(tt.size() == 8);
+		REQUIRE_FALSE(tt.insert("", 1).ok);
+
+		tt.insert("app.logging", "branch and key");
+		REQUIRE(tt.size() == 9);
+		ret = tt.remove("app.logging", false); // keeps file, rotate, words
+		REQUIRE(ret.ok);
+		REQUIRE(tt.size() == 8);
+		REQUIRE(tt.has("app.logging.file"));
+
+		REQUIRE(tt.remove("app.logging.file").ok);
+		REQUIRE(tt.remove("app.logging.rotate").ok);
+		REQUIRE(tt.remove("app.logging.words").ok);
+		REQUIRE(tt.locate("app.logging") == nullptr); // the branch left without keys is gone
+		REQUIRE(tt.remove("app.logging").en == ENOENT);
+
+		tt.insert("app.server.start.delay", 1);
+		REQUIRE(tt.remove("app.server").en == ENOENT); // not a key
+		tt.insert("app.server", 0);
+		REQUIRE(tt.remove("app.server").ok); // with the keys below
+		REQUIRE(tt.size() == 3);
+		REQUIRE(segments_of(tt.locate("app")) == std::vector<std::string>{"debug", "verbose", "dump"});
+	}
+
+	GIVEN("dump") {
+		std::stringstream ss;
+		tt.dump(ss);
+		auto const text = ss.str();
+		REQUIRE(text.starts_with("<root>\n  app"));
+		REQUIRE(text.find("    server") != std::string::npos);
+		REQUIRE(text.find("(app.server.sites) 1") != std::string::npos);
+	}
+}
+
+SCENARIO("trie/segment: random keys", "[trie][segment]") {
+	using namespace trie::tests;
+	segment_store tt;
+	std::map<std::string, int> ref;
+	std::mt19937 rng(29);
+	// wide levels, so that the children are indexed by hash tables
+	auto random_key = [&rng] {
+		std::string key = "s" + std::to_string(rng() % 40);
+		for (auto n = rng() % 3; n > 0; n--) key += ".k" + std::to_string(rng() % 30);
+		return key;
+	};
+
+	for (int round = 0; round < 20000; round++) {
+		auto const key = random_key();
+		if (rng() % 3 != 0) {
+			tt.insert(key, round);
+			ref[key] = round;
+		} else if (rng() % 2) {
+			auto const ret = tt.remove(key, false);
+			REQUIRE(ret.ok == (ref.erase(key) == 1));
+		} else {
+			auto const ret = tt.remove(key);
+			REQUIRE(ret.ok == ref.contains(key));
+			if (ret.ok) {
+				auto const below = key + '.';
+				for (auto it = ref.lower_bound(key); it != ref.end() && (it->first == key || it->first.starts_with(below));)
+					it = ref.erase(it);
+			}
+		}
+		REQUIRE(tt.size() == ref.size());
+
+		if (round % 500 == 0) {
+			for (auto const &[k, v] : ref) REQUIRE(std::get<int>(*tt.find(k)) == v);
+			std::size_t keys{};
+			tt.walk([&](segment_store::node_t const &nd, int) {
+				if (nd.is_leaf()) keys++;
+				REQUIRE((!nd.children().empty() || nd.is_leaf())); // no dangling branches
+			});
+			REQUIRE(keys == ref.size());
+		}
+		auto const probe = random_key();
+		REQUIRE(tt.has(probe) == ref.contains(probe));
+	}
+}
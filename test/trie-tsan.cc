@@ -0,0 +1,65 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+// This test is built with -fsanitize=thread. It runs the const apis
+// of a trie_t from many threads at once, ThreadSanitizer reports any
+// data race among them.
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "trie-cxx/trie-core.hh"
+
+#include <catch2/catch_test_macros.hpp>
+
+namespace trie::tests {
+	inline auto build_frozen_trie(std::vector<std::string> &keys) -> trie::trie_t<trie::value_t> {
+		trie::trie_t<trie::value_t> tt;
+		static char const *sections[] = {"server", "logging", "cache", "db"};
+		for (int i = 0; i < 400; i++) {
+			keys.push_back(std::string("app.") + sections[i % 4] + ".k" + std::to_string(i));
+			tt.insert(keys.back().c_str(), int(i));
+		}
+		return tt;
+	}
+} // namespace trie::tests
+
+SCENARIO("trie/store: concurrent const lookups", "[trie][concurrent][tsan]") {
+	using namespace trie::tests;
+	std::vector<std::string> keys;
+	auto const tt = build_frozen_trie(keys);
+	auto const expected_size = tt.size();
+
+	std::atomic<int> failed{0};
+	std::vector<std::thread> readers;
+	for (int t = 0; t < 8; t++) {
+		readers.emplace_back([&tt, &keys, &failed, expected_size, t] {
+			for (int round = 0; round < 20; round++) {
+				for (std::size_t i = std::size_t(t); i < keys.size(); i += 3) {
+					auto const *key = keys[i].c_str();
+					if (!tt.fast_find(key).matched) failed++;
+					if (!tt.find(key).matched) failed++;
+					if (!std::as_const(*tt.root()).locate(key).matched) failed++;
+					if (!tt.has(key)) failed++;
+					if (tt.get<int>(key) != int(i)) failed++;
+				}
+				if (tt.size() != expected_size) failed++;
+			}
+		});
+	}
+	for (auto &t : readers) t.join();
+
+	REQUIRE(failed == 0);
+}
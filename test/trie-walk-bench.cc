@@ -0,0 +1,158 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#include "trie-cxx/trie-core.hh"
+
+#include <algorithm>
+#include <random>
+#include <string>
+
+// Full-tree walk benchmark: walk(walk_cb), which copies a shared_ptr
+// and calls through a std::function per node, against the template
+// walk(Visitor&&) with the visitor inlined into an iterative loop.
+//
+// Run this:
+//
+//    ./bin/test-trie-walk-bench [keys] [rounds]
+//
+// About 1.4 nodes are made per key, so 7000000 keys give a tree of
+// about 10M nodes (it takes a few GB of memory).
+//
+// bench_keyset dumps the same keys as newline separated text and as
+// a front-coded key set (export_keys), and loads them back by insert()
+// and by import_keys().
+
+namespace trie::tests {
+	using store = trie::trie_t<trie::value_t>;
+	using node_t = store::node_t;
+
+	template<typename Fn>
+	auto best_of(int rounds, Fn &&fn) -> double {
+		double best{-1};
+		for (int i = 0; i < rounds; i++) {
+			double ms{};
+			{
+				trie::chrono::timer tr([&ms](auto duration) -> bool {
+					ms = duration;
+					return false;
+				});
+				fn();
+			}
+			if (best < 0 || ms < best) best = ms;
+		}
+		return best;
+	}
+
+	void build_keys(store &tt, int key_count) {
+		std::mt19937_64 rng(5);
+		static char const *sections[] = {"server", "logging", "cache", "db", "auth", "mq", "metrics", "ui"};
+		for (int i = 0; i < key_count; i++) {
+			auto const key = std::string("app.") + sections[i % 8] + "." + std::to_string(rng() % (std::uint64_t(key_count) * 4));
+			tt.insert(key.c_str(), int(i));
+		}
+	}
+
+	void bench_walk(int key_count, int rounds) {
+		store tt;
+		build_keys(tt, key_count);
+
+		std::size_t nodes{};
+		tt.walk([&nodes](node_t const &, int, int) { nodes++; });
+		std::cout << "tree: " << tt.size() << " keys, " << nodes << " nodes" << '\n';
+
+		auto report = [nodes](char const *title, double ms, std::size_t visited) {
+			std::cout << title << ": " << ms << "ms, " << (ms * 1000 * 1000 / double(nodes)) << "ns/node"
+			          << " (visited: " << visited << ")" << '\n';
+		};
+
+		std::size_t leaves{};
+		auto ms = best_of(rounds, [&] {
+			leaves = 0;
+			tt.walk([&leaves](auto type, auto, int, int) {
+				if (type == node_t::NODE_LEAF) leaves++;
+			});
+		});
+		report("walk(walk_cb)         ", ms, leaves);
+
+		ms = best_of(rounds, [&] {
+			leaves = 0;
+			tt.walk([&leaves](node_t const &nd, int, int) {
+				if (nd.type() == node_t::NODE_LEAF) leaves++;
+			});
+		});
+		report("walk(Visitor&&)       ", ms, leaves);
+
+		std::size_t visited{};
+		ms = best_of(rounds, [&] {
+			visited = 0;
+			tt.walk([&visited](node_t const &, int, int level) {
+				visited++;
+				return level < 3 ? node_t::WALK_CONTINUE : node_t::WALK_PRUNE;
+			});
+		});
+		report("walk(Visitor&&) prune ", ms, visited);
+
+		ms = best_of(rounds, [&] {
+			visited = 0;
+			tt.walk([&visited, half = nodes / 2](node_t const &, int, int) {
+				return ++visited == half ? node_t::WALK_STOP : node_t::WALK_CONTINUE;
+			});
+		});
+		report("walk(Visitor&&) stop  ", ms, visited);
+	}
+
+	void bench_keyset(int key_count, int rounds) {
+		store tt;
+		build_keys(tt, key_count);
+
+		std::string text, packed;
+		auto ms = best_of(rounds, [&] {
+			text.clear();
+			for (auto it = tt.begin(); it != tt.end(); ++it) text.append(it.key()).append(1, '\n');
+		});
+		std::cout << "text export           : " << ms << "ms, " << text.size() << " bytes" << '\n';
+		ms = best_of(rounds, [&] {
+			packed.clear();
+			tt.export_keys(packed);
+		});
+		std::cout << "export_keys           : " << ms << "ms, " << packed.size() << " bytes ("
+		          << double(text.size()) / double(packed.size()) << "x smaller)" << '\n';
+
+		std::size_t loaded{};
+		ms = best_of(rounds, [&] {
+			store t2;
+			std::string key;
+			for (std::size_t pos = 0, eol; (eol = text.find('\n', pos)) != std::string::npos; pos = eol + 1) {
+				key.assign(text, pos, eol - pos);
+				t2.insert(key.c_str(), 0);
+			}
+			loaded = t2.size();
+		});
+		std::cout << "text parse + insert() : " << ms << "ms, " << loaded << " keys" << '\n';
+		ms = best_of(rounds, [&] {
+			store t2;
+			t2.import_keys(packed);
+			loaded = t2.size();
+		});
+		std::cout << "import_keys           : " << ms << "ms, " << loaded << " keys" << '\n';
+	}
+} // namespace trie::tests
+
+int main(int argc, char *argv[]) {
+	int keys{1000000}, rounds{3};
+	if (argc > 1) keys = std::max(1, std::atoi(argv[1]));
+	if (argc > 2) rounds = std::max(1, std::atoi(argv[2]));
+
+	trie::tests::bench_walk(keys, rounds);
+	trie::tests::bench_keyset(keys, rounds);
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_X_BENCH_HH
+#define TRIE_CXX_X_BENCH_HH
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "x-perf.hh"
+
+// The benchmark harness: measure() times a batch of operations and
+// reports ns/op next to the allocations made per op, like go test
+// -benchmem:
+//
+//    insert       100000     412.31 ns/op     3.00 allocs/op      118 B/op
+//
+// The allocations are counted by replacing the global operator new
+// and operator delete, so this header is included by benchmark
+// programs only, and by one translation unit of each. Define
+// TRIE_BENCH_NO_ALLOC_HOOKS to keep the default operators, the
+// allocation columns are 0 then.
+//
+// With TRIE_BENCH_PERF=1 (see x-perf.hh) the hardware counters read
+// per op follow, for those the machine lets us count:
+//
+//    ... 118 B/op    1204.50 cycles/op    1630.12 instructions/op ...
+namespace trie::bench {
+	struct alloc_counters {
+		std::uint64_t allocs{}; // calls of operator new
+		std::uint64_t bytes{};  // bytes asked for by them
+		std::uint64_t frees{};  // calls of operator delete
+	};
+
+	namespace detail {
+		struct alloc_hooks {
+			std::atomic<std::uint64_t> allocs{};
+			std::atomic<std::uint64_t> bytes{};
+			std::atomic<std::uint64_t> frees{};
+		};
+		inline alloc_hooks hooks{};
+
+		inline auto counted_alloc(std::size_t size, std::size_t align) noexcept -> void * {
+			if (size == 0) size = 1;
+			hooks.allocs.fetch_add(1, std::memory_order_relaxed);
+			hooks.bytes.fetch_add(size, std::memory_order_relaxed);
+			if (align <= alignof(std::max_align_t)) return std::malloc(size);
+			return std::aligned_alloc(align, (size + align - 1) / align * align);
+		}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete" // operator new is malloc() here
+#endif
+		inline auto counted_free(void *p) noexcept -> void {
+			if (!p) return;
+			hooks.frees.fetch_add(1, std::memory_order_relaxed);
+			std::free(p);
+		}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+	} // namespace detail
+
+	// the counts since the program started, from all threads
+	inline auto alloc_counts() -> alloc_counters {
+		return {detail::hooks.allocs.load(std::memory_order_relaxed),
+		        detail::hooks.bytes.load(std::memory_order_relaxed),
+		        detail::hooks.frees.load(std::memory_order_relaxed)};
+	}
+
+	struct result_s {
+		std::string name{};
+		std::size_t ops{};
+		double ns_per_op{};
+		double allocs_per_op{};
+		double bytes_per_op{};
+		double frees_per_op{};
+		hw_sample hw{}; // per op, empty unless hw_counters_wanted()
+	};
+
+	/**
+	 * @brief run fn() once, which performs ops operations, and
+	 * measure its time and allocations per operation, and its
+	 * hardware counters if they are wanted.
+	 * @code
+	 * auto r = trie::bench::measure("insert", keys.size(), [&] {
+	 *   for (auto const &k : keys) tt.insert(k.c_str(), 1);
+	 * });
+	 * std::cout << r << '\n';
+	 * @endcode
+	 */
+	template<typename Fn>
+	auto measure(std::string name, std::size_t ops, Fn &&fn) -> result_s {
+		hw_counters *hc = hw_counters_wanted() ? &thread_hw_counters() : nullptr;
+		auto const a0 = alloc_counts();
+		if (hc) hc->start();
+		auto const t0 = std::chrono::steady_clock::now();
+		fn();
+		auto const t1 = std::chrono::steady_clock::now();
+		hw_sample hw = hc ? hc->stop() : hw_sample{};
+		auto const a1 = alloc_counts();
+
+		auto const n = double(ops ? ops : 1);
+		result_s r{std::move(name), ops};
+		r.ns_per_op = double(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()) / n;
+		r.allocs_per_op = double(a1.allocs - a0.allocs) / n;
+		r.bytes_per_op = double(a1.bytes - a0.bytes) / n;
+		r.frees_per_op = double(a1.frees - a0.frees) / n;
+		for (auto &v : hw.values) v /= n;
+		r.hw = hw;
+		return r;
+	}
+
+	inline auto operator<<(std::ostream &os, result_s const &r) -> std::ostream & {
+		auto const flags = os.flags();
+		auto const precision = os.precision();
+		os << std::left << std::setw(24) << r.name << std::right << std::setw(10) << r.ops
+		   << std::fixed << std::setprecision(2)
+		   << std::setw(12) << r.ns_per_op << " ns/op"
+		   << std::setw(10) << r.allocs_per_op << " allocs/op"
+		   << std::setprecision(0) << std::setw(10) << r.bytes_per_op << " B/op";
+		os << std::setprecision(2);
+		for (std::size_t i = 0; i < hw_event_count; i++)
+			if (r.hw.has(hw_event(i))) os << std::setw(12) << r.hw.values[i] << ' ' << hw_event_names[i] << "/op";
+		os.flags(flags);
+		os.precision(precision);
+		return os;
+	}
+} // namespace trie::bench
+
+#if !defined(TRIE_BENCH_NO_ALLOC_HOOKS)
+// the replaceable global allocation functions, the array forms and the
+// remaining sized forms of the standard library forward to these.
+void *operator new(std::size_t size) {
+	if (auto *p = trie::bench::detail::counted_alloc(size, 0)) return p;
+	throw std::bad_alloc{};
+}
+void *operator new(std::size_t size, std::align_val_t al) {
+	if (auto *p = trie::bench::detail::counted_alloc(size, std::size_t(al))) return p;
+	throw std::bad_alloc{};
+}
+void *operator new(std::size_t size, std::nothrow_t const &) noexcept {
+	return trie::bench::detail::counted_alloc(size, 0);
+}
+void *operator new(std::size_t size, std::align_val_t al, std::nothrow_t const &) noexcept {
+	return trie::bench::detail::counted_alloc(size, std::size_t(al));
+}
+void operator delete(void *p) noexcept { trie::bench::detail::counted_free(p); }
+void operator delete(void *p, std::size_t) noexcept { trie::bench::detail::counted_free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { trie::bench::detail::counted_free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { trie::bench::detail::counted_free(p); }
+void operator delete(void *p, std::nothrow_t const &) noexcept { trie::bench::detail::counted_free(p); }
+void operator delete(void *p, std::align_val_t, std::nothrow_t const &) noexcept { trie::bench::detail::counted_free(p); }
+#endif
+
+#endif // TRIE_CXX_X_BENCH_HH
@@ -0,0 +1,214 @@
+/*
+ * @copy Copyright © 2016 - 2024 Hedzr Yeh.
+ *
+ * trie - C++17/C++20 Text Difference Utilities Library
+ *
+ * This file is part of trie.
+ *
+ * trie is free software: you can redistribute it and/or modify
+ * it under the terms of the Apache 2.0 License.
+ * Read /LICENSE for more information.
+ */
+
+#ifndef TRIE_CXX_X_PERF_HH
+#define TRIE_CXX_X_PERF_HH
+
+#include <array>
+#include <atomic>
+#include <string>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters for the benchmark harness, read with
+// Linux perf_event_open(2) around each measured region. They count
+// the user-space work of the calling thread and of the threads it
+// starts meanwhile.
+//
+// The counters are optional: they are read when use_hw_counters(true)
+// was called or TRIE_BENCH_PERF=1 is set in the environment. An event
+// which cannot be opened, because perf_event_paranoid forbids it, the
+// CPU or the VM has no PMU, or this is not Linux, is left out of the
+// results; hw_counters::error() tells why.
+namespace trie::bench {
+	enum class hw_event : unsigned {
+		cycles,
+		instructions,
+		l1d_misses,    // L1 data cache read misses
+		llc_misses,    // last level cache misses
+		branch_misses, // mispredicted branches
+		dtlb_misses,   // data TLB read misses
+	};
+	static constexpr std::size_t hw_event_count = 6;
+	static constexpr char const *hw_event_names[hw_event_count] = {
+	        "cycles", "instructions", "L1d-misses", "LLC-misses", "branch-misses", "dTLB-misses"};
+
+	/**
+	 * @brief the counts of the events which could be read, per
+	 * operation once measure() divided them.
+	 */
+	struct hw_sample {
+		std::array<double, hw_event_count> values{};
+		unsigned valid{}; // a bit per hw_event counted
+
+		auto empty() const -> bool { return valid == 0; }
+		auto has(hw_event e) const -> bool { return valid & (1u << unsigned(e)); }
+		auto operator[](hw_event e) const -> double { return values[std::size_t(e)]; }
+	};
+
+	/**
+	 * @brief hw_counters opens one counter per hw_event for the
+	 * calling thread, and reads them between start() and stop().
+	 * @details The events are not grouped, so that one missing on a
+	 * CPU does not take the others with it. When the PMU has fewer
+	 * counters than events the kernel multiplexes them, and the counts
+	 * are scaled up by the share of the time each one ran.
+	 */
+	class hw_counters {
+	public:
+		hw_counters() { open(); }
+		~hw_counters() { close(); }
+		hw_counters(hw_counters const &) = delete;
+		hw_counters &operator=(hw_counters const &) = delete;
+
+		auto available() const -> bool { return _open != 0; }
+		// why some event could not be opened, empty if none failed
+		auto error() const -> std::string const & { return _error; }
+
+		auto start() -> void {
+#if defined(__linux__)
+			for (std::size_t i = 0; i < hw_event_count; i++) {
+				if (!(_open & (1u << i))) continue;
+				read_one(i, _start[i]);
+				::ioctl(_fd[i], PERF_EVENT_IOC_ENABLE, 0);
+			}
+#endif
+		}
+
+		// the counts since start()
+		auto stop() -> hw_sample {
+			hw_sample s;
+#if defined(__linux__)
+			for (std::size_t i = 0; i < hw_event_count; i++) {
+				if (!(_open & (1u << i))) continue;
+				::ioctl(_fd[i], PERF_EVENT_IOC_DISABLE, 0);
+				reading now;
+				if (!read_one(i, now)) continue;
+				auto const running = now.running - _start[i].running;
+				if (running == 0) continue; // never scheduled on the PMU
+				auto const enabled = now.enabled - _start[i].enabled;
+				s.values[i] = double(now.value - _start[i].value) * double(enabled) / double(running);
+				s.valid |= 1u << i;
+			}
+#endif
+			return s;
+		}
+
+	private:
+		struct reading {
+			std::uint64_t value{};
+			std::uint64_t enabled{}; // time_enabled
+			std::uint64_t running{}; // time_running
+		};
+
+#if defined(__linux__)
+		auto open() -> void {
+			static constexpr std::uint64_t read_miss = (std::uint64_t(PERF_COUNT_HW_CACHE_OP_READ) << 8) |
+			                                           (std::uint64_t(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+			static constexpr struct {
+				std::uint32_t type;
+				std::uint64_t config;
+			} events[hw_event_count] = {
+			        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+			        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+			        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | read_miss},
+			        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+			        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+			        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | read_miss},
+			};
+			for (std::size_t i = 0; i < hw_event_count; i++) {
+				perf_event_attr attr{};
+				attr.size = sizeof(attr);
+				attr.type = events[i].type;
+				attr.config = events[i].config;
+				attr.disabled = 1;
+				attr.inherit = 1;
+				attr.exclude_kernel = 1; // allowed up to perf_event_paranoid 2
+				attr.exclude_hv = 1;
+				attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+				auto const fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+				if (fd >= 0) {
+					_fd[i] = fd;
+					_open |= 1u << i;
+				} else if (_error.empty()) {
+					_error = describe(hw_event_names[i], errno);
+				}
+			}
+		}
+		auto close() -> void {
+			for (std::size_t i = 0; i < hw_event_count; i++)
+				if (_open & (1u << i)) ::close(_fd[i]);
+			_open = 0;
+		}
+		auto read_one(std::size_t i, reading &r) const -> bool {
+			std::uint64_t buf[3];
+			if (::read(_fd[i], buf, sizeof(buf)) != static_cast<ssize_t>(sizeof(buf))) return false;
+			r = {buf[0], buf[1], buf[2]};
+			return true;
+		}
+		static auto describe(char const *event, int en) -> std::string {
+			std::string msg{event};
+			msg += ": ";
+			msg += std::strerror(en);
+			if (en == EACCES || en == EPERM)
+				msg += " (see /proc/sys/kernel/perf_event_paranoid)";
+			else if (en == ENOENT || en == EOPNOTSUPP || en == ENODEV)
+				msg += " (no such counter on this CPU or VM)";
+			return msg;
+		}
+#else
+		auto open() -> void { _error = "hardware counters need Linux perf_event_open"; }
+		auto close() -> void {}
+#endif
+
+	private:
+		std::array<int, hw_event_count> _fd{};
+		std::array<reading, hw_event_count> _start{};
+		unsigned _open{}; // a bit per hw_event opened
+		std::string _error{};
+	}; // class hw_counters
+
+	namespace detail {
+		inline std::atomic<int> hw_wanted{-1}; // -1: ask the environment
+	} // namespace detail
+
+	inline auto use_hw_counters(bool on) -> void { detail::hw_wanted.store(on ? 1 : 0, std::memory_order_relaxed); }
+
+	inline auto hw_counters_wanted() -> bool {
+		auto v = detail::hw_wanted.load(std::memory_order_relaxed);
+		if (v < 0) {
+			auto const *env = std::getenv("TRIE_BENCH_PERF");
+			v = env && *env && std::strcmp(env, "0") != 0;
+			detail::hw_wanted.store(v, std::memory_order_relaxed);
+		}
+		return v != 0;
+	}
+
+	// the counters of the calling thread, opened on first use
+	inline auto thread_hw_counters() -> hw_counters & {
+		thread_local hw_counters counters;
+		return counters;
+	}
+} // namespace trie::bench
+
+#endif // TRIE_CXX_X_PERF_HH